@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Distinct event names ("status", "enroll_status", ...) kept by the publisher.
+#ifndef EVENT_TYPES_MAX
+#define EVENT_TYPES_MAX 4
+#endif
+
+#ifndef EVENT_SUBSCRIBERS_MAX
+#define EVENT_SUBSCRIBERS_MAX 64
+#endif
+
+// Largest event body, also the size of the JSON buffers in main.cpp.
+#ifndef EVENT_DATA_MAX
+#define EVENT_DATA_MAX 384
+#endif
+
+// One destination for events: the AsyncEventSource on the device, a
+// simulated browser on the host.
+class EventSubscriber
+{
+public:
+	virtual ~EventSubscriber() {}
+	// Messages accepted but not yet on the wire.
+	virtual size_t backlog() = 0;
+	virtual void send(const char *event, const char *data, uint32_t id) = 0;
+};
+
+// Coalescing front end for server-sent events. Only the newest message of
+// each event type is kept. A subscriber gets it once its backlog is below
+// maxBacklog; until then newer messages replace the held one, which is
+// counted as dropped. Memory is fixed, whatever the number of updates or
+// how slow a subscriber is.
+class EventPublisher
+{
+public:
+	explicit EventPublisher(size_t maxBacklog);
+
+	bool addSubscriber(EventSubscriber *subscriber);
+	void removeSubscriber(EventSubscriber *subscriber);
+
+	// Copies the message, then delivers what the subscribers can take.
+	void publish(const char *event, const char *data);
+	// Retries held-back messages; call periodically.
+	void pump();
+
+	uint32_t delivered() const { return deliveredCount; }
+	uint32_t dropped() const { return droppedCount; }
+	// Messages currently held back, summed over subscribers.
+	size_t held();
+
+private:
+	struct Message
+	{
+		char event[16];
+		char data[EVENT_DATA_MAX];
+		uint32_t id;
+		uint32_t seq;
+	};
+	struct Subscription
+	{
+		EventSubscriber *subscriber;
+		uint32_t pending; // bit per Message
+	};
+
+	int typeIndex(const char *event);
+	void deliver(Subscription &subscription);
+
+	const size_t maxBacklog;
+	Message messages[EVENT_TYPES_MAX];
+	size_t typeCount = 0;
+	Subscription subscriptions[EVENT_SUBSCRIBERS_MAX];
+	size_t subscriptionCount = 0;
+	uint32_t nextSeq = 1;
+	uint32_t deliveredCount = 0;
+	uint32_t droppedCount = 0;
+	SemaphoreHandle_t lock;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Confirmation codes of the R30x/R50x protocol, spelled like
+// Adafruit_Fingerprint so either header may come first.
+#ifndef FINGERPRINT_OK
+#define FINGERPRINT_OK 0x00
+#define FINGERPRINT_PACKETRECIEVEERR 0x01
+#define FINGERPRINT_NOFINGER 0x02
+#define FINGERPRINT_IMAGEFAIL 0x03
+#define FINGERPRINT_IMAGEMESS 0x06
+#define FINGERPRINT_FEATUREFAIL 0x07
+#define FINGERPRINT_NOMATCH 0x08
+#define FINGERPRINT_NOTFOUND 0x09
+#define FINGERPRINT_ENROLLMISMATCH 0x0A
+#define FINGERPRINT_BADLOCATION 0x0B
+#define FINGERPRINT_FLASHERR 0x18
+#endif
+
+// The sensor commands the kiosk uses. On the device this is a thin adapter
+// over Adafruit_Fingerprint, on the host a scripted sensor. Every call is
+// one UART round trip and returns a confirmation code.
+class FingerprintSensor
+{
+public:
+	virtual ~FingerprintSensor() {}
+	virtual uint8_t getImage() = 0;
+	// Turns the last image into features in char buffer `slot` (1 or 2).
+	virtual uint8_t image2Tz(uint8_t slot = 1) = 0;
+	// Searches the library for buffer 1; sets fingerID on FINGERPRINT_OK.
+	virtual uint8_t fingerSearch() = 0;
+	// Combines buffers 1 and 2 into a template, stored at `id`.
+	virtual uint8_t createModel() = 0;
+	virtual uint8_t storeModel(uint16_t id) = 0;
+
+	uint16_t fingerID = 0;
+};
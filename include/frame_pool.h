@@ -0,0 +1,67 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Number of pre-allocated JPEG slots: one being written, one published and
+// one for a reader still sending an older frame. Each further reader that
+// holds a different older frame pins another slot; with none left the
+// encoder drops its frame (kiosk_frames_dropped_total). Use viewers + 2 to
+// never drop one.
+#ifndef FRAME_POOL_SLOTS
+#define FRAME_POOL_SLOTS 3
+#endif
+
+// Default capacity of every slot in bytes. Frames that do not fit are dropped.
+#ifndef FRAME_POOL_SLOT_SIZE
+#define FRAME_POOL_SLOT_SIZE (48 * 1024)
+#endif
+
+struct FrameSlot
+{
+	uint8_t *buf;
+	size_t capacity;
+	size_t len;
+	uint32_t seq;
+	struct timeval timestamp;
+	// Dimensions of raw (grayscale) frames; unused for JPEG slots.
+	uint16_t width;
+	uint16_t height;
+	int refs;
+};
+
+// Fixed pool of reference counted JPEG buffers shared between the encoder
+// and the HTTP handlers. Nothing is allocated after begin().
+class FramePool
+{
+public:
+	// Allocates every slot, from PSRAM if present. On failure frees the ones
+	// already allocated and leaves the pool empty.
+	bool begin(size_t slotSize = FRAME_POOL_SLOT_SIZE);
+
+	// Encoder side: take a free slot, fill it, then publish or abort it.
+	FrameSlot *acquireWrite();
+	void publish(FrameSlot *slot);
+	void abort(FrameSlot *slot);
+
+	// Reader side: borrow the newest frame, release it when done.
+	FrameSlot *borrowLatest();
+	// Like borrowLatest(), but returns nullptr unless the newest frame is
+	// newer than lastSeq, so consumers skip straight to the latest frame.
+	FrameSlot *borrowNewer(uint32_t lastSeq);
+	void release(FrameSlot *slot);
+
+	// Drops the published frame so stale images are not served later.
+	void clear();
+
+	// Appends encoder output to a slot being written, for frame2jpg_cb().
+	static size_t writeCallback(void *arg, size_t index, const void *data, size_t len);
+
+private:
+	FrameSlot slots[FRAME_POOL_SLOTS];
+	FrameSlot *latest = nullptr;
+	uint32_t nextSeq = 1;
+	portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Preview frames of the kiosk UI.
+extern FramePool framePool;
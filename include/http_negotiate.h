@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Request header checks for serving pre-compressed pages from flash. Both
+// take the whole header value (no length limit) and accept nullptr for a
+// header the request did not send.
+
+// True if an Accept-Encoding value allows coding (e.g. "br"). Weights are
+// honoured: "br;q=0" refuses br, and a listed coding overrides "*".
+bool acceptsEncoding(const char *header, const char *coding);
+
+// True if an If-None-Match value matches etag under the weak comparison
+// the header is defined with: W/"x" and "x" match each other, "*" matches
+// anything.
+bool etagMatches(const char *header, const char *etag);
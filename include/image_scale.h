@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Integer box-filter downscaling of 8-bit grayscale frames, used to shrink
+// the QR reader's frames before the preview JPEG encode.
+//
+// factor is 1, 2 or 4. Every output pixel is the rounded mean of a
+// factor x factor block; trailing columns/rows that do not fill a whole
+// block are dropped. dst must hold (width / factor) * (height / factor)
+// bytes and may not overlap src. Returns the number of bytes written, or
+// 0 for an unsupported factor.
+size_t downscaleGray(const uint8_t *src, int width, int height, int factor, uint8_t *dst);
+
+// Byte-at-a-time reference implementation with identical output, kept for
+// the host benchmark and for checking the word-at-a-time kernels.
+size_t downscaleGrayScalar(const uint8_t *src, int width, int height, int factor, uint8_t *dst);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Builds one flat JSON object in a caller-supplied buffer, typically on the
+// stack, without touching the heap. Strings are escaped. When the buffer
+// runs out, string values are cut at a character boundary, later fields
+// are dropped and ok() turns false; the output is always a closed object.
+class JsonWriter
+{
+public:
+	JsonWriter(char *buf, size_t size);
+
+	JsonWriter &field(const char *key, const char *value);
+	JsonWriter &field(const char *key, int value);
+
+	// Closes the object and returns the NUL-terminated text.
+	const char *finish();
+
+	size_t length() const { return len; }
+	bool ok() const { return !truncated; }
+
+private:
+	bool beginField(const char *key);
+	bool put(const char *s, size_t n);
+	void putEscaped(const char *s);
+
+	char *buf;
+	size_t size;
+	size_t len = 0;
+	bool truncated = false;
+	bool first = true;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include "fingerprint_sensor.h"
+#include "state_cell.h"
+#include "state_machine.h"
+
+// The rental flow: fingerprint match, QR scan, uplink, back to LOCKED, and
+// enrollment in between. Hardware and the web side are reached through a
+// FingerprintSensor and a KioskPlatform, so the same code runs on the host.
+
+#define FINGERPRINT_POLL_MIN_MS 100
+#define FINGERPRINT_POLL_MAX_MS 500
+
+// Longest QR payload handed to the kiosk, including the terminator.
+#ifndef KIOSK_QR_PAYLOAD_MAX
+#define KIOSK_QR_PAYLOAD_MAX 256
+#endif
+
+enum SystemState
+{
+	LOCKED,
+	UNLOCKED_SCANNING,
+	SUCCESS,
+	ENROLLING
+};
+
+// What the kiosk needs from the board and the web server.
+class KioskPlatform
+{
+public:
+	virtual ~KioskPlatform() {}
+	// Tells the browsers; `shown` is the text for the state's screen.
+	virtual void stateEntered(SystemState state, const char *shown) = 0;
+	virtual void sendEnrollStatus(const char *status, const char *message) = 0;
+	// Camera and preview up, before SCANNING is published.
+	virtual void powerUp() = 0;
+	// Camera down and preview frames dropped, before LOCKED is published.
+	virtual void powerDown() = 0;
+	// Waits up to timeout for a decoded code and copies its text, cut to
+	// size. presentedUs as in qrScannerReceive().
+	virtual bool receiveQr(char *payload, size_t size, TickType_t timeout, int64_t *presentedUs) = 0;
+	// True while a touch line says nobody is on the sensor; without one
+	// the sensor is polled and this stays false.
+	virtual bool sensorUntouched() { return false; }
+};
+
+// Starts the fingerprint and QR tasks in LOCKED. successDisplayMs is how
+// long the SUCCESS screen stays up before the kiosk locks again.
+bool kioskBegin(FingerprintSensor &sensor, KioskPlatform &platform, uint32_t successDisplayMs);
+
+// LOCKED -> ENROLLING for template `id`, for /start_enroll. False if the
+// kiosk is busy, including when a match got there first.
+bool kioskStartEnroll(int id);
+
+// Parses "<anything>;<laptop id>-<name>" and queues the toggle for userId.
+// Returns true if an event was queued.
+bool processQrPayload(const char *qrPayload, int userId);
+
+extern StateCell kioskState;
+extern StateMachine kioskMachine;
+
+inline SystemState kioskCurrentState()
+{
+	return (SystemState)kioskState.state();
+}
+
+extern TaskHandle_t fingerprintTaskHandle;
+extern TaskHandle_t qrCodeTaskHandle;
+extern TaskHandle_t enrollmentTaskHandle;
+
+// UART round trips to the sensor, total and over the last full minute.
+extern volatile uint32_t fingerprintUartTransactions;
+extern volatile uint32_t fingerprintUartPerMinute;
+// getImage -> fingerSearch time of the last successful match, in us.
+extern volatile uint32_t fingerprintMatchLatencyUs;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include "supabase_client.h"
+
+// How a scan toggles laptop_acc.user_id. Both modes are a single atomic
+// statement on the server, and only the user holding a laptop can return
+// it: a laptop rented by someone else is left alone.
+//
+// A toggle is not idempotent, so every write also stamps the row with the
+// event id and skips rows already carrying it. An event redelivered after
+// its response was lost then matches nothing instead of undoing itself:
+//   alter table laptop_acc add column last_event bigint not null default 0;
+//
+//   TOGGLE_MODE_PATCH - conditional PATCH filtered on user_id=is.null
+//                       (checkout), falling back to user_id=eq.<user>
+//                       (return) when no row matched. A checkout is one
+//                       round trip, a return two.
+//   TOGGLE_MODE_RPC   - one POST to /rpc/toggle_laptop_user either way,
+//                       which needs:
+//     create or replace function toggle_laptop_user(p_laptop_id int, p_user_id int, p_event bigint)
+//     returns setof laptop_acc language sql as $$
+//       update laptop_acc
+//          set user_id = case when user_id is null then p_user_id else null end,
+//              last_event = p_event
+//        where id = p_laptop_id
+//          and (user_id is null or user_id = p_user_id)
+//          and last_event <> p_event
+//       returning *;
+//     $$;
+#define TOGGLE_MODE_PATCH 0
+#define TOGGLE_MODE_RPC 1
+
+// Checks laptop_id out to user_id, or returns it. event_id must be nonzero
+// and stay the same when the toggle is retried. Returns false when the
+// request should be retried (no WiFi, network error or 5xx); any other
+// answer from the server is final.
+bool laptopToggle(SupabaseClient &db, int mode, int laptop_id, int user_id, uint32_t event_id, uint32_t traceId);
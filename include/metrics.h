@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <initializer_list>
+
+#define HISTOGRAM_MAX_BUCKETS 12
+
+// Running total of µs or bytes, which a 32-bit counter wraps within hours
+// (encode time after ~72 min of streaming, JPEG bytes after 4 GiB). The
+// ESP32 has no lock-free 64-bit atomics, so updates take a critical section.
+struct Counter64
+{
+	uint64_t value = 0;
+	mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Fixed-bucket histogram exported in Prometheus cumulative form. Bounds are
+// inclusive upper limits in ascending order; a +Inf bucket is implied.
+struct Histogram
+{
+	Histogram() {}
+	Histogram(std::initializer_list<uint32_t> upperBounds) { setBounds(upperBounds); }
+	// For histograms that live in arrays; call before the first observe().
+	void setBounds(std::initializer_list<uint32_t> upperBounds);
+
+	void observe(uint32_t value);
+	// Writes _bucket/_sum/_count samples; HELP/TYPE only when help is given.
+	void write(Print &out, const char *name, const char *help, const char *labels = nullptr) const;
+
+	uint32_t bounds[HISTOGRAM_MAX_BUCKETS];
+	size_t buckets = 0;
+	std::atomic<uint32_t> counts[HISTOGRAM_MAX_BUCKETS + 1] = {};
+	Counter64 sum;
+};
+
+// Runtime counters shared by the firmware tasks. Counts and gauges are
+// relaxed 32-bit atomics so the hot paths (one update per encoded frame)
+// stay cheap; totals of µs and bytes are Counter64.
+struct Metrics
+{
+	std::atomic<uint32_t> framesEncoded{0};
+	std::atomic<uint32_t> framesDropped{0};
+	Counter64 encodeUsTotal;
+	Counter64 jpegBytes;
+	std::atomic<uint32_t> jpegLastBytes{0};
+	std::atomic<uint32_t> backendRequests{0};
+	std::atomic<uint32_t> backendErrors{0};
+	std::atomic<uint32_t> backendLatencyMsTotal{0};
+	std::atomic<uint32_t> backendLastLatencyMs{0};
+	std::atomic<uint32_t> qrRoiFallbacks{0};
+	std::atomic<uint32_t> qrRoiForcedScans{0};
+	// Time to locate + decode one frame, on a tracked ROI or the whole frame.
+	Histogram qrDecodeRoiUs{2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000};
+	Histogram qrDecodeFullUs{2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000};
+	// Code first located by the scanner to SUCCESS sent to the kiosk.
+	Histogram qrPresentToSuccessMs{25, 50, 100, 200, 350, 500, 1000, 2000, 5000};
+	// Idle power mode: wake started (fingerprint match) to first camera frame.
+	Histogram wakeToFirstFrameMs{50, 100, 200, 300, 500, 750, 1000, 1500, 2000, 5000};
+};
+
+extern Metrics metrics;
+
+inline void metricAdd(std::atomic<uint32_t> &counter, uint32_t value = 1)
+{
+	counter.fetch_add(value, std::memory_order_relaxed);
+}
+
+inline void metricSet(std::atomic<uint32_t> &gauge, uint32_t value)
+{
+	gauge.store(value, std::memory_order_relaxed);
+}
+
+inline uint32_t metricGet(const std::atomic<uint32_t> &metric)
+{
+	return metric.load(std::memory_order_relaxed);
+}
+
+inline void metricAdd(Counter64 &counter, uint64_t value)
+{
+	portENTER_CRITICAL(&counter.mux);
+	counter.value += value;
+	portEXIT_CRITICAL(&counter.mux);
+}
+
+inline uint64_t metricGet(const Counter64 &counter)
+{
+	portENTER_CRITICAL(&counter.mux);
+	uint64_t value = counter.value;
+	portEXIT_CRITICAL(&counter.mux);
+	return value;
+}
+
+// Writes one sample in Prometheus text exposition format. HELP/TYPE lines
+// are emitted when help is given, so labelled series can share them.
+void metricWrite(Print &out, const char *name, const char *type, const char *help, double value, const char *labels = nullptr);
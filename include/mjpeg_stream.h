@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include "frame_pool.h"
+#include "rate_controller.h"
+
+// Returned by MjpegStream::fill() when no newer frame is published yet.
+// Same value as AsyncWebServer's RESPONSE_TRY_AGAIN.
+#define MJPEG_TRY_AGAIN 0xFFFFFFFF
+
+// The connection a stream is written to: an AsyncWebServer response on the
+// device, a simulated socket on the host.
+class MjpegSink
+{
+public:
+	virtual ~MjpegSink() {}
+	// Makes the transport call fill() again now rather than on its next
+	// ack or poll. Called from MjpegHub::wake() with the hub locked.
+	virtual void resume() = 0;
+};
+
+// One viewer of a multipart/x-mixed-replace stream. Each part borrows the
+// newest frame from the pool and is written straight from the slot, so N
+// viewers share one encode and one buffer.
+class MjpegStream
+{
+public:
+	MjpegStream(FramePool &pool, MjpegSink &sink, RateController *rate = nullptr);
+	~MjpegStream();
+
+	// Writes up to maxLen bytes of boundary, part header and JPEG. Returns
+	// MJPEG_TRY_AGAIN when the newest frame was already sent; the stream
+	// then waits for MjpegHub::wake(). Returns 0 once end() was called and
+	// the current part is complete.
+	size_t fill(uint8_t *buffer, size_t maxLen);
+	// Ends the stream at the next part boundary.
+	void end() { ending = true; }
+
+	uint32_t partsSent() const { return parts; }
+
+private:
+	friend class MjpegHub;
+
+	FramePool &pool;
+	MjpegSink &sink;
+	RateController *rate;
+	FrameSlot *slot = nullptr;
+	uint32_t lastSeq = 0;
+	int64_t lastSentUs = 0;
+	size_t offset = 0;
+	size_t headerLen = 0;
+	char header[160];
+	uint32_t parts = 0;
+	bool ending = false;
+	// Last fill() found nothing new.
+	bool waiting = false;
+	MjpegStream *next = nullptr;
+};
+
+// The open streams of one pool. The transport calls fill() with the hub
+// locked, so wake() never runs into a fill() already in progress. The lock
+// is recursive: a connection closing inside fill() may remove its stream.
+class MjpegHub
+{
+public:
+	bool begin();
+
+	void lock();
+	void unlock();
+
+	// Both lock the hub themselves.
+	void add(MjpegStream *stream);
+	void remove(MjpegStream *stream);
+
+	// Resumes every waiting stream; call after FramePool::publish().
+	// Returns how many were resumed.
+	int wake();
+
+private:
+	SemaphoreHandle_t mutex = NULL;
+	MjpegStream *streams = nullptr;
+};
+
+// Streams of the kiosk preview (framePool).
+extern MjpegHub mjpegHub;
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Decoded codes on their way from the scan task (qr_scanner.cpp) to the
+// kiosk's QR task. Kept apart from the scanner, which needs the camera, so
+// the hand-off runs on the host as well.
+
+// Longest payload handed over, including the terminator; longer codes are
+// cut.
+#ifndef QR_HANDOFF_PAYLOAD_MAX
+#define QR_HANDOFF_PAYLOAD_MAX 256
+#endif
+
+// Results the QR task may fall behind by before new ones are dropped.
+#ifndef QR_HANDOFF_DEPTH
+#define QR_HANDOFF_DEPTH 2
+#endif
+
+bool qrHandoffBegin();
+
+// Scan task, once per decoded frame; never blocks. presentedUs is the
+// esp_timer time of the first frame in which the code was located, i.e.
+// roughly when it was held up to the camera.
+bool qrScannerPublish(const char *payload, size_t len, int64_t presentedUs);
+
+// Waits up to timeout for a decoded code and copies its text, cut to size.
+// presentedUs, if given, gets the time passed to qrScannerPublish().
+bool qrScannerReceive(char *payload, size_t size, TickType_t timeout, int64_t *presentedUs = nullptr);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <ESP32QRCodeReader.h>
+#include "frame_pool.h"
+#include "qr_tracker.h"
+#include "qr_handoff.h"
+
+// ESP32QRCodeReader runs its own decode task on 40 KB, with quirc_code and
+// quirc_data (about 13 KB) as locals. QuircDecoder keeps those two static,
+// so the same headroom fits in 28 KB; what is left on the stack is quirc's
+// own working state in quirc_end() and quirc_decode(). Trim it by
+// kiosk_task_stack_free_min_bytes{task="QRScan"} on /metrics.
+#ifndef QR_SCANNER_STACK_SIZE
+#define QR_SCANNER_STACK_SIZE (28 * 1024)
+#endif
+#ifndef QR_SCANNER_PRIORITY
+#define QR_SCANNER_PRIORITY 5
+#endif
+
+// Raw grayscale frame size for the preview pool (QVGA, the reader's size).
+#ifndef QR_RAW_FRAME_SIZE
+#define QR_RAW_FRAME_SIZE (320 * 240)
+#endif
+
+// Capture + decode task that replaces ESP32QRCodeReader's own task; the
+// reader is still used for camera setup(). Where each frame is decoded is
+// up to QrTracker (qr_tracker.h). Decoded codes go out through
+// qrScannerPublish() (qr_handoff.h).
+bool qrScannerBegin(BaseType_t core);
+extern TaskHandle_t qrScanTaskHandle;
+
+// While pool is set, every captured grayscale frame is copied into it
+// (width/height filled in) for the preview; nullptr stops the copies.
+void qrScannerPublishFrames(FramePool *pool);
+
+// Parks the scan task between frames and returns once it holds no frame
+// buffer, so the caller may esp_camera_deinit(). No-op if already asleep.
+void qrScannerSleep();
+
+// Restarts capture after qrScannerSleep(); the camera must be initialized
+// again first. The time from wokenUs (esp_timer) to the first captured
+// frame goes into metrics.wakeToFirstFrameMs.
+void qrScannerWake(int64_t wokenUs);
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Margin kept around the last located code, in percent of its size on
+// each side, so a code moving between frames stays inside the ROI.
+#ifndef QR_ROI_MARGIN_PCT
+#define QR_ROI_MARGIN_PCT 50
+#endif
+
+// ROI sizes are rounded up to this many pixels so quirc is not resized
+// (reallocated) on every small movement.
+#ifndef QR_ROI_QUANTUM
+#define QR_ROI_QUANTUM 32
+#endif
+
+// Tracked frames in a row where the ROI locates a code it cannot decode
+// before the whole frame is scanned anyway. Without it, a glare-covered
+// code or a pattern that only looks like finder marks would keep the
+// scanner on the ROI and blind to a readable code elsewhere.
+#ifndef QR_ROI_MAX_MISSES
+#define QR_ROI_MAX_MISSES 5
+#endif
+
+struct QrRegion
+{
+	int x, y, w, h;
+};
+
+// What one locate + decode pass over a region found. where is the bounds
+// of the decoded code, else of the last one located, in frame coordinates.
+struct QrFound
+{
+	bool located;
+	bool decoded;
+	QrRegion where;
+};
+
+// One quirc pass over a region of a grayscale frame: quirc on the device,
+// a scripted stand-in on the host.
+class QrDecoder
+{
+public:
+	virtual ~QrDecoder() {}
+	virtual QrFound decode(const uint8_t *frame, int width, int height, const QrRegion &region) = 0;
+};
+
+// Decides per frame where to look. Once a code has been located, later
+// frames are decoded on a region around it. The whole frame is scanned when
+// nothing is tracked, when the region comes up empty, and after
+// QR_ROI_MAX_MISSES tracked frames that located but never decoded; after
+// such a forced scan it stays on the whole frame until a code decodes or
+// nothing is located. Pass times and fallbacks go to metrics.
+class QrTracker
+{
+public:
+	explicit QrTracker(QrDecoder &decoder) : decoder(decoder) {}
+
+	QrFound scan(const uint8_t *frame, int width, int height);
+	// Forgets the tracked code, e.g. when the camera sleeps.
+	void reset()
+	{
+		tracked = false;
+		stuck = false;
+		misses = 0;
+	}
+
+	bool tracking() const { return tracked; }
+	const QrRegion &region() const { return roi; }
+	// Pixels handed to the decoder by the last scan().
+	uint32_t lastScannedPixels() const { return scannedPixels; }
+
+private:
+	QrDecoder &decoder;
+	bool tracked = false;
+	QrRegion roi = {0, 0, 0, 0};
+	bool stuck = false;
+	int misses = 0;
+	uint32_t scannedPixels = 0;
+};
+
+// Grows a code's bounding box by QR_ROI_MARGIN_PCT, rounds it up to
+// QR_ROI_QUANTUM and clamps it to the frame.
+QrRegion qrRoiAround(const QrRegion &code, int frameW, int frameH);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include "qr_tracker.h"
+
+struct quirc;
+
+// Largest payload kept from a decoded code; longer ones are truncated.
+#ifndef QR_PAYLOAD_MAX
+#define QR_PAYLOAD_MAX 1024
+#endif
+
+// QrDecoder on quirc. Needs nothing from the camera or the reader library
+// beyond quirc itself. Each geometry (ROI or whole frame) has its own quirc
+// instance, so switching between them does not reallocate.
+class QuircDecoder : public QrDecoder
+{
+public:
+	bool begin();
+	QrFound decode(const uint8_t *frame, int width, int height, const QrRegion &region) override;
+
+	// The last decoded code.
+	char payload[QR_PAYLOAD_MAX];
+	int payloadLen = 0;
+	int dataType = 0;
+
+private:
+	struct Instance
+	{
+		struct quirc *q = nullptr;
+		int w = 0;
+		int h = 0;
+	};
+	bool load(Instance &in, int w, int h);
+
+	Instance full;
+	Instance roi;
+};
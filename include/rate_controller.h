@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Closed-loop JPEG quality controller for the kiosk preview stream.
+// Consumers report every frame they finish sending; once per window the
+// controller looks at the slowest viewer and nudges quality so the stream
+// holds the target fps within the target bitrate. The preview is encoded
+// from the QR reader's frames, so its capture size is fixed and quality is
+// the only knob. Viewers always take the newest frame, so a
+// slow link shows up as a longer interval between sends rather than as a
+// growing queue.
+class RateController
+{
+public:
+	RateController(uint8_t initialQuality, uint8_t minQuality, uint8_t maxQuality,
+				   uint8_t targetFps, uint32_t targetKbps);
+
+	// One sent frame: its size and the time since the same viewer's
+	// previous frame.
+	void onFrameSent(size_t bytes, uint32_t intervalUs);
+
+	// Encoder quality, 1-100 with higher meaning better (frame2jpg scale).
+	uint8_t quality() const { return currentQuality; }
+
+private:
+	void evaluate();
+
+	const uint8_t minQuality;
+	const uint8_t maxQuality;
+	const uint8_t targetFps;
+	const uint32_t targetKbps;
+	volatile uint8_t currentQuality;
+
+	// Current window.
+	uint32_t frames = 0;
+	uint32_t bytes = 0;
+	uint32_t intervalSumUs = 0;
+	uint32_t worstIntervalUs = 0;
+	portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
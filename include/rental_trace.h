@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Number of rentals kept for the /trace percentiles.
+#ifndef RENTAL_TRACE_DEPTH
+#define RENTAL_TRACE_DEPTH 32
+#endif
+
+// Stages of one rental, in the order they normally happen.
+enum TraceStage
+{
+	STAGE_TOUCH,		  // getImage that led to the match started
+	STAGE_MATCH,		  // fingerSearch returned a user
+	STAGE_RESUMED,		  // streaming/QR tasks resumed
+	STAGE_FIRST_FRAME,	  // first preview frame encoded after resume
+	STAGE_QR_DECODED,	  // reader handed us a valid code
+	STAGE_QUEUED,		  // rental event accepted by the uplink
+	STAGE_UPLINK_START,	  // uplink picked the event up
+	STAGE_FIRST_RESPONSE, // first backend response received
+	STAGE_COMMITTED,	  // laptop_acc row changed
+	STAGE_COUNT
+};
+
+// Starts a new rental trace at the given esp_timer time and returns its id.
+// Storage is a fixed ring, the oldest rental is overwritten.
+uint32_t traceBegin(int64_t touchUs);
+
+// Records a stage of a rental at the current time. The first mark of a
+// stage wins, so it is safe to call from per-frame paths.
+void traceMark(uint32_t id, TraceStage stage);
+
+// The rental currently going through the kiosk, 0 if none.
+extern volatile uint32_t currentTraceId;
+
+// Writes per-stage p50/p90/p99/max latencies over the stored rentals.
+void traceReport(Print &out);
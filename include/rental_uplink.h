@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Maximum number of rental events waiting for delivery, in RAM and in NVS.
+#ifndef RENTAL_UPLINK_CAPACITY
+#define RENTAL_UPLINK_CAPACITY 16
+#endif
+
+struct RentalEvent
+{
+	int laptopId;
+	int userId;
+	uint32_t traceId;
+	// Never 0 and the same on every delivery attempt, so the backend can
+	// tell a redelivery from a new scan. Assigned by the uplink task.
+	uint32_t eventId;
+};
+
+// Delivers one event. Returns true once the backend has given a final
+// answer, false when the attempt should be retried later.
+typedef bool (*RentalDeliverFn)(const RentalEvent &event);
+
+// Starts the uplink task and reloads events left in flash by a previous boot.
+bool rentalUplinkBegin(RentalDeliverFn deliver);
+
+// Queues an event without blocking. Returns false if the queue is full.
+bool rentalUplinkEnqueue(int laptopId, int userId, uint32_t traceId = 0);
+
+// Events accepted but not yet delivered.
+size_t rentalUplinkPending();
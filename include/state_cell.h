@@ -0,0 +1,38 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+#ifndef STATE_PAYLOAD_MAX
+#define STATE_PAYLOAD_MAX 256
+#endif
+
+// Immutable copy of the kiosk state as readers see it.
+struct StateSnapshot
+{
+	int state;
+	uint32_t version; // bumped on every publish
+	char payload[STATE_PAYLOAD_MAX];
+};
+
+// The current state plus its payload, published under a sequence lock.
+// Writers are serialized by a short critical section around a copy;
+// readers never block, they retry if a write overlapped their copy. The
+// state alone is also kept in an atomic for the common "which state?"
+// check.
+class StateCell
+{
+public:
+	explicit StateCell(int initialState);
+
+	void publish(int state, const char *payload);
+
+	void read(StateSnapshot &out) const;
+	int state() const { return currentState.load(std::memory_order_acquire); }
+
+private:
+	std::atomic<uint32_t> seq{0};
+	std::atomic<int> currentState;
+	StateSnapshot snapshot;
+	portMUX_TYPE writeMux = portMUX_INITIALIZER_UNLOCKED;
+};
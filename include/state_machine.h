@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include "state_cell.h"
+#include "metrics.h"
+
+#ifndef STATE_MACHINE_MAX_STATES
+#define STATE_MACHINE_MAX_STATES 8
+#endif
+
+// One legal edge. onExit runs while the machine still reports `from`, then
+// the new state is published and onEnter runs. Both run on the task that
+// asked for the transition, with the payload it passed, and without the
+// machine's lock held: a transition out of `from` asked for meanwhile is
+// refused at once, one out of `to` waits until onEnter has returned. They
+// own the side effects of the edge (power, task wake-ups, SSE events) and
+// must not call transition(). Work that has to be finished before anyone
+// can act on the new state belongs in onExit.
+struct Transition
+{
+	int from;
+	int to;
+	void (*onExit)(const char *payload);
+	void (*onEnter)(const char *payload);
+};
+
+// For static_assert on a transition table: no (from, to) pair twice.
+// Written as C++11 single-return recursion for the ESP32 toolchain.
+constexpr bool transitionsUnique(const Transition *table, size_t count, size_t i = 0, size_t j = 1)
+{
+	return i >= count ? true
+		   : j >= count ? transitionsUnique(table, count, i + 1, i + 2)
+		   : (table[i].from == table[j].from && table[i].to == table[j].to) ? false
+																			  : transitionsUnique(table, count, i, j + 1);
+}
+
+// Table-driven front end to a StateCell. Every state change goes through
+// transition(): edges missing from the table are rejected and counted, two
+// tasks racing for the same state cannot both win, and the time spent in
+// each state is recorded. The hooks of one edge never interleave with
+// another's, but a slow onExit only holds up the tasks it races with, and
+// only until they are told they lost.
+class StateMachine
+{
+public:
+	StateMachine(StateCell &cell, const Transition *table, size_t count, const char *const *stateNames, size_t stateCount);
+
+	// Moves from the current state to `to`. Returns false, changing nothing,
+	// if the table has no such edge.
+	bool transition(int to, const char *payload = "");
+	// Same, but only when the current state is `from`.
+	bool transition(int from, int to, const char *payload);
+
+	int state() const { return cell.state(); }
+	const char *name(int state) const;
+	uint32_t rejected() const { return rejectedCount.load(std::memory_order_relaxed); }
+
+	// <prefix>_dwell_seconds histogram per state, <prefix>_current_seconds
+	// and <prefix>_rejected_transitions_total.
+	void writeMetrics(Print &out, const char *prefix);
+
+private:
+	const Transition *find(int from, int to) const;
+
+	StateCell &cell;
+	const Transition *table;
+	const size_t count;
+	const char *const *stateNames;
+	const size_t stateCount;
+	uint32_t enteredMs;
+	std::atomic<uint32_t> rejectedCount{0};
+	Histogram dwellSeconds[STATE_MACHINE_MAX_STATES];
+	// Held for the state check and the publish, never across a hook.
+	SemaphoreHandle_t lock;
+	// Under lock: a task is running onExit and the state is about to change.
+	bool leaving = false;
+	// Held by the transitioning task across onEnter.
+	SemaphoreHandle_t entering;
+	// Guards enteredMs for writeMetrics().
+	portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
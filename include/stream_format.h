@@ -0,0 +1,7 @@
+#pragma once
+
+// multipart/x-mixed-replace framing shared by every MJPEG endpoint.
+#define PART_BOUNDARY "123456789000000000000987654321"
+static const char _STREAM_CONTENT_TYPE[] = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
+static const char _STREAM_BOUNDARY[] = "\r\n--" PART_BOUNDARY "\r\n";
+static const char _STREAM_PART[] = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+
+// Long-lived PostgREST client. The TLS connection is kept open between
+// requests (HTTP keep-alive) so a rental costs one handshake at most, and
+// is re-established when the server or WiFi drops it. A request is only
+// sent again when it never left: a kept-alive socket that fails on send.
+// A connection lost after sending is returned as an error, because the
+// server may already have applied the request.
+class SupabaseClient
+{
+public:
+	SupabaseClient(const char *baseUrl, const char *apiKey);
+
+	// Both return the HTTP status code (or a negative HTTPC_ERROR_*) and
+	// fill response with the body.
+	int get(const String &path, String &response);
+	int patch(const String &path, const char *body, String &response);
+	int post(const String &path, const char *body, String &response);
+
+	// Number of TLS handshakes performed so far.
+	uint32_t handshakes() const { return handshakeCount; }
+
+private:
+	int request(const char *method, const String &path, const char *body, String &response);
+
+	const char *baseUrl;
+	const char *apiKey;
+	WiFiClientSecure tls;
+	HTTPClient http;
+	uint32_t handshakeCount = 0;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+// Host stand-in for the subset of Arduino-ESP32 and FreeRTOS used by the
+// portable firmware modules. Tasks are pthreads with a notification
+// counter, queues are mutex/condvar rings and critical sections are a
+// single global mutex.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <sys/time.h>
+#include <algorithm>
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+
+using std::min;
+using std::max;
+
+uint32_t millis();
+void delay(uint32_t ms);
+int64_t esp_timer_get_time();
+uint32_t esp_random();
+
+inline void *ps_malloc(size_t size) { return malloc(size); }
+
+// Byte sink with formatted output; subclasses implement write().
+class Print
+{
+public:
+	virtual ~Print() {}
+	virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+	size_t write(uint8_t c) { return write(&c, 1); }
+	int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t println(const char *s = "") { return print(s) + print("\n"); }
+};
+
+#include "WString.h"
+
+// stdout; one write() is never interleaved with another thread's.
+class HardwareSerial : public Print
+{
+public:
+	using Print::write;
+	void begin(unsigned long) {}
+	size_t write(const uint8_t *buffer, size_t size) override;
+};
+extern HardwareSerial Serial;
+
+// --- FreeRTOS ---
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct NativeTask *TaskHandle_t;
+typedef struct NativeQueue *QueueHandle_t;
+typedef struct NativeSemaphore *SemaphoreHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core);
+// Only a task deleting itself (NULL) is supported; it ends the thread.
+void vTaskDelete(TaskHandle_t task);
+// Threads not started by xTaskCreate get a handle on first use.
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait);
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore);
+
+struct portMUX_TYPE
+{
+	int unused;
+};
+#define portMUX_INITIALIZER_UNLOCKED {0}
+void portENTER_CRITICAL(portMUX_TYPE *mux);
+void portEXIT_CRITICAL(portMUX_TYPE *mux);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// In-process stand-in for the HTTPS server behind every URL. A handler
+// answers requests; each TLS handshake and each request costs the
+// configured latency and is counted. Faults reproduce the ways a kept-alive
+// connection breaks on the device:
+//   closeIdle()        - the server closed idle sockets and the client saw
+//                        the FIN: connected() turns false.
+//   resetNext()        - the socket died silently: the next request fails
+//                        on send (HTTPC_ERROR_SEND_HEADER_FAILED) and never
+//                        reaches the handler.
+//   loseNextResponse() - the next request reaches the handler, which
+//                        commits it, but the response is lost
+//                        (HTTPC_ERROR_CONNECTION_LOST).
+class NativeHttpServer
+{
+public:
+	// Returns the status code and fills response.
+	typedef std::function<int(const char *method, const String &uri, const String &body, String &response)> Handler;
+
+	void setHandler(Handler fn);
+	void setLatency(uint32_t handshakeMs, uint32_t requestMs);
+
+	void closeIdle() { generation++; }
+	void resetNext() { resetPending = true; }
+	void loseNextResponse() { losePending = true; }
+
+	uint32_t handshakes() const { return handshakeCount.load(); }
+	uint32_t requests() const { return requestCount.load(); }
+
+private:
+	friend class HTTPClient;
+	friend class WiFiClientSecure;
+
+	std::mutex mutex;
+	Handler handler;
+	uint32_t handshakeMs = 0;
+	uint32_t requestMs = 0;
+	std::atomic<uint32_t> generation{1};
+	std::atomic<bool> resetPending{false};
+	std::atomic<bool> losePending{false};
+	std::atomic<uint32_t> handshakeCount{0};
+	std::atomic<uint32_t> requestCount{0};
+};
+extern NativeHttpServer HttpServer;
+
+// Subset of the ESP32 HTTPClient used by SupabaseClient: one request at a
+// time over a WiFiClientSecure, kept open between requests with setReuse().
+class HTTPClient
+{
+public:
+	bool begin(WiFiClientSecure &client, const String &url);
+	bool setURL(const String &url);
+	void setReuse(bool reuse) { this->reuse = reuse; }
+	void addHeader(const String &name, const String &value) {}
+	int sendRequest(const char *method, uint8_t *payload, size_t size);
+	String getString() { return body; }
+	void end();
+
+private:
+	WiFiClientSecure *client = nullptr;
+	String uri;
+	String body;
+	bool reuse = true;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+// NVS stand-in that keeps each key in a file under NATIVE_NVS_DIR
+// (default: .pio/nvs), so persisted state survives a simulated reboot.
+class Preferences
+{
+public:
+	bool begin(const char *name, bool readOnly = false);
+	size_t getBytesLength(const char *key);
+	size_t getBytes(const char *key, void *buf, size_t maxLen);
+	size_t putBytes(const char *key, const void *value, size_t len);
+	bool remove(const char *key);
+
+private:
+	void path(const char *key, char *out, size_t outLen);
+	char ns[32] = "";
+};
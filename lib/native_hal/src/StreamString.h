@@ -0,0 +1,15 @@
+#pragma once
+
+#include <Arduino.h>
+
+// A String that can be printed to, as in Arduino-ESP32.
+class StreamString : public Print, public String
+{
+public:
+	using Print::write;
+	size_t write(const uint8_t *buffer, size_t size) override
+	{
+		*this += String(std::string((const char *)buffer, size));
+		return size;
+	}
+};
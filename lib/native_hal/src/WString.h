@@ -0,0 +1,61 @@
+#pragma once
+
+// Subset of Arduino's String over std::string, enough for the HTTP
+// client stand-in and the modules that build PostgREST paths.
+
+#include <string>
+
+class String
+{
+public:
+	String(const char *s = "") : text(s ? s : "") {}
+	String(const std::string &s) : text(s) {}
+	explicit String(char c) : text(1, c) {}
+	explicit String(int value) : text(std::to_string(value)) {}
+	explicit String(unsigned int value) : text(std::to_string(value)) {}
+	explicit String(long value) : text(std::to_string(value)) {}
+	explicit String(unsigned long value) : text(std::to_string(value)) {}
+
+	const char *c_str() const { return text.c_str(); }
+	unsigned int length() const { return text.size(); }
+	bool isEmpty() const { return text.empty(); }
+	char operator[](unsigned int i) const { return i < text.size() ? text[i] : 0; }
+
+	int indexOf(char c, unsigned int from = 0) const { return find(text.find(c, from)); }
+	int indexOf(const char *s, unsigned int from = 0) const { return find(text.find(s, from)); }
+	int indexOf(const String &s, unsigned int from = 0) const { return find(text.find(s.text, from)); }
+	bool startsWith(const char *s) const { return text.compare(0, strlen(s), s) == 0; }
+	String substring(unsigned int from) const { return from < text.size() ? String(text.substr(from)) : String(); }
+	String substring(unsigned int from, unsigned int to) const { return from < to && from < text.size() ? String(text.substr(from, to - from)) : String(); }
+	long toInt() const { return atol(text.c_str()); }
+
+	String &operator+=(const String &s)
+	{
+		text += s.text;
+		return *this;
+	}
+	String &operator+=(const char *s)
+	{
+		text += s;
+		return *this;
+	}
+	String &operator+=(char c)
+	{
+		text += c;
+		return *this;
+	}
+
+	friend String operator+(const String &a, const String &b) { return String(a.text + b.text); }
+	friend String operator+(const String &a, const char *b) { return String(a.text + b); }
+	friend String operator+(const char *a, const String &b) { return String(a + b.text); }
+
+	bool operator==(const String &s) const { return text == s.text; }
+	bool operator==(const char *s) const { return text == s; }
+	bool operator!=(const String &s) const { return text != s.text; }
+	bool operator!=(const char *s) const { return text != s; }
+
+private:
+	static int find(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+
+	std::string text;
+};
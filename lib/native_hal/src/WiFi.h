@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum
+{
+	WL_IDLE_STATUS = 0,
+	WL_CONNECTED = 3,
+	WL_DISCONNECTED = 6
+} wl_status_t;
+
+// Link state is driven by the simulation instead of a radio.
+class WiFiClass
+{
+public:
+	wl_status_t status() { return connected ? WL_CONNECTED : WL_DISCONNECTED; }
+	void setConnected(bool up) { connected = up; }
+
+private:
+	volatile bool connected = true;
+};
+extern WiFiClass WiFi;
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <Arduino.h>
+
+// TLS socket to the in-process HTTPS stand-in (see HTTPClient.h). connect()
+// is the handshake; the connection dies when the server closes idle
+// sockets, on an injected reset, or when stop() is called.
+class WiFiClientSecure
+{
+public:
+	void setInsecure() {}
+	bool connect(const char *host, uint16_t port);
+	bool connected();
+	void stop() { open = false; }
+
+private:
+	bool open = false;
+	uint32_t generation = 0;
+};
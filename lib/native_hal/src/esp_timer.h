@@ -0,0 +1,4 @@
+#pragma once
+
+// esp_timer_get_time() lives in the Arduino.h stand-in.
+#include <Arduino.h>
@@ -0,0 +1,329 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include "Preferences.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sys/stat.h>
+
+HardwareSerial Serial;
+WiFiClass WiFi;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+static std::mutex serialMutex;
+static std::recursive_mutex criticalMutex;
+
+int64_t esp_timer_get_time()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint32_t millis()
+{
+	return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+uint32_t esp_random()
+{
+	static std::random_device device;
+	return device();
+}
+
+void delay(uint32_t ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int Print::printf(const char *format, ...)
+{
+	char small[256];
+	va_list arg;
+	va_start(arg, format);
+	int len = vsnprintf(small, sizeof(small), format, arg);
+	va_end(arg);
+	if (len < 0)
+		return len;
+	if ((size_t)len < sizeof(small))
+		return write((const uint8_t *)small, len);
+	std::vector<char> big(len + 1);
+	va_start(arg, format);
+	vsnprintf(big.data(), big.size(), format, arg);
+	va_end(arg);
+	return write((const uint8_t *)big.data(), len);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+	std::lock_guard<std::mutex> lock(serialMutex);
+	size_t written = fwrite(buffer, 1, size, stdout);
+	fflush(stdout);
+	return written;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	delay(ticks * portTICK_PERIOD_MS);
+}
+
+struct NativeTask
+{
+	TaskFunction_t fn;
+	void *arg;
+	std::mutex mutex;
+	std::condition_variable notified;
+	uint32_t notifyValue = 0;
+};
+
+static thread_local NativeTask *currentTask = nullptr;
+
+static void *runTask(void *arg)
+{
+	currentTask = (NativeTask *)arg;
+	currentTask->fn(currentTask->arg);
+	return nullptr;
+}
+
+// Handles are never freed: like on the device, other tasks may keep
+// notifying a handle after the task ended.
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle)
+{
+	NativeTask *task = new NativeTask();
+	task->fn = fn;
+	task->arg = arg;
+	if (handle)
+		*handle = task;
+	pthread_t thread;
+	if (pthread_create(&thread, nullptr, runTask, task) != 0)
+	{
+		if (handle)
+			*handle = nullptr;
+		delete task;
+		return pdFALSE;
+	}
+	pthread_detach(thread);
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	if (task && task != currentTask)
+		abort();
+	pthread_exit(nullptr);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+	if (!currentTask)
+		currentTask = new NativeTask();
+	return currentTask;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	std::lock_guard<std::mutex> lock(task->mutex);
+	task->notifyValue++;
+	task->notified.notify_all();
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait)
+{
+	NativeTask *task = xTaskGetCurrentTaskHandle();
+	std::unique_lock<std::mutex> lock(task->mutex);
+	auto ready = [task]
+	{ return task->notifyValue > 0; };
+	if (wait == portMAX_DELAY)
+		task->notified.wait(lock, ready);
+	else
+		task->notified.wait_for(lock, std::chrono::milliseconds(wait * portTICK_PERIOD_MS), ready);
+	uint32_t value = task->notifyValue;
+	if (value)
+		task->notifyValue = clearOnExit ? 0 : value - 1;
+	return value;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t prio, TaskHandle_t *handle, BaseType_t core)
+{
+	return xTaskCreate(fn, name, stack, arg, prio, handle);
+}
+
+struct NativeQueue
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::vector<uint8_t> storage;
+	size_t itemSize;
+	size_t length;
+	size_t head = 0;
+	size_t count = 0;
+};
+
+static bool waitFor(NativeQueue *queue, std::unique_lock<std::mutex> &lock, TickType_t wait, bool (*ready)(NativeQueue *))
+{
+	if (wait == portMAX_DELAY)
+	{
+		queue->changed.wait(lock, [queue, ready]
+							{ return ready(queue); });
+		return true;
+	}
+	return queue->changed.wait_for(lock, std::chrono::milliseconds(wait * portTICK_PERIOD_MS), [queue, ready]
+								   { return ready(queue); });
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+	NativeQueue *queue = new NativeQueue();
+	queue->storage.resize(length * itemSize);
+	queue->itemSize = itemSize;
+	queue->length = length;
+	return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait)
+{
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	if (!waitFor(queue, lock, wait, [](NativeQueue *q)
+				 { return q->count < q->length; }))
+		return pdFALSE;
+	size_t tail = (queue->head + queue->count) % queue->length;
+	memcpy(&queue->storage[tail * queue->itemSize], item, queue->itemSize);
+	queue->count++;
+	queue->changed.notify_all();
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait)
+{
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	if (!waitFor(queue, lock, wait, [](NativeQueue *q)
+				 { return q->count > 0; }))
+		return pdFALSE;
+	memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+	queue->head = (queue->head + 1) % queue->length;
+	queue->count--;
+	queue->changed.notify_all();
+	return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	return queue->count;
+}
+
+struct NativeSemaphore
+{
+	std::timed_mutex mutex;
+	std::recursive_timed_mutex recursive;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+	return new NativeSemaphore();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+	if (wait == portMAX_DELAY)
+	{
+		semaphore->mutex.lock();
+		return pdTRUE;
+	}
+	return semaphore->mutex.try_lock_for(std::chrono::milliseconds(wait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+	semaphore->mutex.unlock();
+	return pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+	return new NativeSemaphore();
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+	if (wait == portMAX_DELAY)
+	{
+		semaphore->recursive.lock();
+		return pdTRUE;
+	}
+	return semaphore->recursive.try_lock_for(std::chrono::milliseconds(wait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+	semaphore->recursive.unlock();
+	return pdTRUE;
+}
+
+void portENTER_CRITICAL(portMUX_TYPE *mux)
+{
+	criticalMutex.lock();
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE *mux)
+{
+	criticalMutex.unlock();
+}
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+	snprintf(ns, sizeof(ns), "%s", name);
+	const char *dir = getenv("NATIVE_NVS_DIR");
+	mkdir(dir ? dir : ".pio", 0755);
+	if (!dir)
+		mkdir(".pio/nvs", 0755);
+	return true;
+}
+
+void Preferences::path(const char *key, char *out, size_t outLen)
+{
+	const char *dir = getenv("NATIVE_NVS_DIR");
+	snprintf(out, outLen, "%s/%s.%s", dir ? dir : ".pio/nvs", ns, key);
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+	char file[256];
+	path(key, file, sizeof(file));
+	struct stat st;
+	return stat(file, &st) == 0 ? (size_t)st.st_size : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+	char file[256];
+	path(key, file, sizeof(file));
+	FILE *f = fopen(file, "rb");
+	if (!f)
+		return 0;
+	size_t len = fread(buf, 1, maxLen, f);
+	fclose(f);
+	return len;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+	char file[256];
+	path(key, file, sizeof(file));
+	FILE *f = fopen(file, "wb");
+	if (!f)
+		return 0;
+	size_t written = fwrite(value, 1, len, f);
+	fclose(f);
+	return written;
+}
+
+bool Preferences::remove(const char *key)
+{
+	char file[256];
+	path(key, file, sizeof(file));
+	return ::remove(file) == 0;
+}
@@ -0,0 +1,94 @@
+#include "HTTPClient.h"
+#include "WiFi.h"
+
+NativeHttpServer HttpServer;
+
+void NativeHttpServer::setHandler(Handler fn)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	handler = fn;
+}
+
+void NativeHttpServer::setLatency(uint32_t handshake, uint32_t request)
+{
+	handshakeMs = handshake;
+	requestMs = request;
+}
+
+bool WiFiClientSecure::connect(const char *host, uint16_t port)
+{
+	open = false;
+	if (WiFi.status() != WL_CONNECTED)
+		return false;
+	HttpServer.handshakeCount++;
+	delay(HttpServer.handshakeMs);
+	generation = HttpServer.generation;
+	open = true;
+	return true;
+}
+
+bool WiFiClientSecure::connected()
+{
+	return open && generation == HttpServer.generation && WiFi.status() == WL_CONNECTED;
+}
+
+// Only the path matters: every host is HttpServer.
+bool HTTPClient::begin(WiFiClientSecure &tls, const String &url)
+{
+	int scheme = url.indexOf("://");
+	int path = scheme < 0 ? -1 : url.indexOf('/', scheme + 3);
+	if (path < 0)
+		return false;
+	client = &tls;
+	uri = url.substring(path);
+	return true;
+}
+
+bool HTTPClient::setURL(const String &url)
+{
+	if (url[0] != '/')
+		return false;
+	uri = url;
+	return true;
+}
+
+int HTTPClient::sendRequest(const char *method, uint8_t *payload, size_t size)
+{
+	body = String();
+	if (!client)
+		return HTTPC_ERROR_NOT_CONNECTED;
+	bool fresh = false;
+	if (!client->connected())
+	{
+		if (!client->connect("stand-in", 443))
+			return HTTPC_ERROR_CONNECTION_REFUSED;
+		fresh = true;
+	}
+	// A silently dead socket only shows up on a request that reuses it.
+	if (!fresh && HttpServer.resetPending.exchange(false))
+	{
+		client->stop();
+		return HTTPC_ERROR_SEND_HEADER_FAILED;
+	}
+	delay(HttpServer.requestMs);
+	String request = payload ? String(std::string((const char *)payload, size)) : String();
+	int code;
+	{
+		std::lock_guard<std::mutex> lock(HttpServer.mutex);
+		HttpServer.requestCount++;
+		code = HttpServer.handler ? HttpServer.handler(method, uri, request, body) : 404;
+	}
+	if (HttpServer.losePending.exchange(false))
+	{
+		body = String();
+		client->stop();
+		return HTTPC_ERROR_CONNECTION_LOST;
+	}
+	return code;
+}
+
+void HTTPClient::end()
+{
+	if (client && !reuse)
+		client->stop();
+}
@@ -0,0 +1,106 @@
+#include "scripted_sensor.h"
+#include <chrono>
+#include <thread>
+
+// Packet sizes of the commands used, header and checksum included.
+#define PACKET_ACK 12
+#define PACKET_GET_IMAGE 12
+#define PACKET_IMAGE2TZ 13
+#define PACKET_SEARCH 17
+#define PACKET_SEARCH_ACK 16
+#define PACKET_REG_MODEL 12
+#define PACKET_STORE 15
+
+ScriptedSensor::ScriptedSensor(uint32_t baud, uint32_t byteOverheadUs, float byteErrorRate, uint32_t seed)
+	: byteUs(10000000 / baud + byteOverheadUs), byteErrorRate(byteErrorRate), random(seed)
+{
+}
+
+void ScriptedSensor::enroll(uint16_t id, int print)
+{
+	std::lock_guard<std::mutex> lock(state);
+	library[id] = print;
+}
+
+bool ScriptedSensor::enrolled(uint16_t id)
+{
+	std::lock_guard<std::mutex> lock(state);
+	return library.count(id) != 0;
+}
+
+bool ScriptedSensor::exchange(size_t cmdBytes, size_t replyBytes)
+{
+	commandCount++;
+	if (inFlight++ != 0)
+		overlapCount++;
+	std::this_thread::sleep_for(std::chrono::microseconds(byteUs * (cmdBytes + replyBytes)));
+	bool intact = true;
+	if (byteErrorRate > 0)
+	{
+		std::lock_guard<std::mutex> lock(state);
+		std::uniform_real_distribution<float> uniform(0, 1);
+		for (size_t i = 0; i < cmdBytes + replyBytes && intact; i++)
+			intact = uniform(random) >= byteErrorRate;
+	}
+	inFlight--;
+	return intact;
+}
+
+uint8_t ScriptedSensor::getImage()
+{
+	if (!exchange(PACKET_GET_IMAGE, PACKET_ACK))
+		return FINGERPRINT_PACKETRECIEVEERR;
+	std::lock_guard<std::mutex> lock(state);
+	image = finger;
+	return image ? FINGERPRINT_OK : FINGERPRINT_NOFINGER;
+}
+
+uint8_t ScriptedSensor::image2Tz(uint8_t slot)
+{
+	if (!exchange(PACKET_IMAGE2TZ, PACKET_ACK))
+		return FINGERPRINT_PACKETRECIEVEERR;
+	std::lock_guard<std::mutex> lock(state);
+	if (!image)
+		return FINGERPRINT_IMAGEFAIL;
+	charBuffer[slot == 2 ? 1 : 0] = image;
+	return FINGERPRINT_OK;
+}
+
+uint8_t ScriptedSensor::fingerSearch()
+{
+	searchCount++;
+	if (!exchange(PACKET_SEARCH, PACKET_SEARCH_ACK))
+		return FINGERPRINT_PACKETRECIEVEERR;
+	std::lock_guard<std::mutex> lock(state);
+	for (const auto &entry : library)
+	{
+		if (charBuffer[0] && entry.second == charBuffer[0])
+		{
+			fingerID = entry.first;
+			return FINGERPRINT_OK;
+		}
+	}
+	return FINGERPRINT_NOTFOUND;
+}
+
+uint8_t ScriptedSensor::createModel()
+{
+	if (!exchange(PACKET_REG_MODEL, PACKET_ACK))
+		return FINGERPRINT_PACKETRECIEVEERR;
+	std::lock_guard<std::mutex> lock(state);
+	if (!charBuffer[0] || charBuffer[0] != charBuffer[1])
+		return FINGERPRINT_ENROLLMISMATCH;
+	model = charBuffer[0];
+	return FINGERPRINT_OK;
+}
+
+uint8_t ScriptedSensor::storeModel(uint16_t id)
+{
+	if (!exchange(PACKET_STORE, PACKET_ACK))
+		return FINGERPRINT_PACKETRECIEVEERR;
+	std::lock_guard<std::mutex> lock(state);
+	if (id == 0 || id >= 1000)
+		return FINGERPRINT_BADLOCATION;
+	library[id] = model;
+	return FINGERPRINT_OK;
+}
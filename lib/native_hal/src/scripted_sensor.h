@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include "fingerprint_sensor.h"
+
+// Host stand-in for an R30x module behind a UART. A test puts a finger on
+// it (any nonzero print) and lifts it again; enrollment stores the print
+// as a template that later fingerSearch() calls match.
+//
+// Every command blocks for its command and reply packets on the wire:
+// 10 bits per byte at `baud`, plus byteOverheadUs per byte for the CPU
+// side of the transport. With byteErrorRate > 0, a packet with a bad byte
+// is answered with FINGERPRINT_PACKETRECIEVEERR, as Adafruit_Fingerprint
+// does on a checksum failure. The module's own imaging and search time is
+// the same for every transport and is not modelled.
+class ScriptedSensor : public FingerprintSensor
+{
+public:
+	explicit ScriptedSensor(uint32_t baud = 57600, uint32_t byteOverheadUs = 0, float byteErrorRate = 0, uint32_t seed = 1);
+
+	void touch(int print) { finger = print; }
+	void lift() { finger = 0; }
+	bool touched() const { return finger != 0; }
+	// Stores a template as if `print` had been enrolled at `id`.
+	void enroll(uint16_t id, int print);
+	bool enrolled(uint16_t id);
+
+	uint8_t getImage() override;
+	uint8_t image2Tz(uint8_t slot = 1) override;
+	uint8_t fingerSearch() override;
+	uint8_t createModel() override;
+	uint8_t storeModel(uint16_t id) override;
+
+	// Round trips so far, and how many started while another was still on
+	// the wire (two tasks driving the UART at once).
+	uint32_t commands() const { return commandCount.load(); }
+	uint32_t overlaps() const { return overlapCount.load(); }
+	// fingerSearch() calls, the expensive command.
+	uint32_t searches() const { return searchCount.load(); }
+
+private:
+	// Sends a command of cmdBytes and waits for a reply of replyBytes;
+	// false if either packet was garbled.
+	bool exchange(size_t cmdBytes, size_t replyBytes);
+
+	const uint32_t byteUs;
+	const float byteErrorRate;
+	std::atomic<int> finger{0};
+	std::atomic<int> inFlight{0};
+	std::atomic<uint32_t> commandCount{0};
+	std::atomic<uint32_t> overlapCount{0};
+	std::atomic<uint32_t> searchCount{0};
+	// Module state, only touched by the command that holds the wire.
+	std::mutex state;
+	int image = 0;
+	int charBuffer[2] = {0, 0};
+	int model = 0;
+	std::map<uint16_t, int> library;
+	std::mt19937 random;
+};
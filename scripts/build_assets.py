@@ -0,0 +1,191 @@
+"""Minify and compress the web UI sources into C headers of PROGMEM arrays.
+
+Runs as a PlatformIO pre-build script (extra_scripts = pre:scripts/build_assets.py)
+or standalone: python3 scripts/build_assets.py [output dir]
+
+The headers are build output, not sources: PlatformIO writes them to
+$BUILD_DIR/assets and adds that directory to the include path, standalone
+runs write to .pio/assets. They are only rewritten when their content
+changes, so an unchanged UI does not trigger a rebuild.
+
+gzip output comes from zopfli and, for pages listed in BROTLI, a quality-11
+brotli variant (<symbol>_br, <symbol>_br_len, <symbol>_br_etag) from
+brotli. Both are pinned in COMPRESSORS so every machine builds the same
+bytes and ETags. PlatformIO installs the pinned versions into its own
+Python when they are missing; a standalone run, or a failed install, stops
+with an error instead of falling back to another encoder. Sizes are printed
+and written next to the headers in asset_sizes.txt.
+"""
+
+import hashlib
+import importlib
+import os
+import re
+import sys
+
+try:
+    from importlib.metadata import PackageNotFoundError, version
+except ImportError:  # Python < 3.8
+    from importlib_metadata import PackageNotFoundError, version
+
+try:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+except NameError:
+    # SCons does not define __file__; PlatformIO runs from the project dir.
+    ROOT = os.getcwd()
+
+# header -> [(source html, C symbol prefix)]
+BUNDLES = {
+    "kiosk_pages.h": [
+        ("web/kiosk/index.html", "kiosk_index_html"),
+        ("web/kiosk/enroll.html", "kiosk_enroll_html"),
+    ],
+    "camera_index.h": [
+        ("web/camera/index_ov2640.html", "index_ov2640_html"),
+        ("web/camera/index_ov3660.html", "index_ov3660_html"),
+        ("web/camera/index_ov5640.html", "index_ov5640_html"),
+    ],
+}
+
+# Headers whose pages are served with Accept-Encoding negotiation.
+BROTLI = {"kiosk_pages.h"}
+
+SIZE_REPORT = "asset_sizes.txt"
+
+# PyPI distribution -> (module, pinned version)
+COMPRESSORS = {
+    "zopfli": ("zopfli.gzip", "0.2.3"),
+    "Brotli": ("brotli", "1.1.0"),
+}
+
+
+def missing_compressors():
+    missing = []
+    for dist, (module, pinned) in COMPRESSORS.items():
+        try:
+            installed = version(dist)
+        except PackageNotFoundError:
+            installed = None
+        if installed != pinned:
+            missing.append((dist, pinned, installed))
+    return missing
+
+
+def load_compressors(env=None):
+    """Imports the pinned compressors, installing them into PlatformIO's
+    Python first when env is given. Exits the build when they are not
+    available at the pinned versions."""
+    missing = missing_compressors()
+    if missing and env is not None:
+        pins = " ".join('"%s==%s"' % (dist, pinned) for dist, pinned, _ in missing)
+        env.Execute(env.VerboseAction('"$PYTHONEXE" -m pip install %s' % pins,
+                                      "Installing pinned asset compressors"))
+        importlib.invalidate_caches()
+        missing = missing_compressors()
+    if missing:
+        for dist, pinned, installed in missing:
+            sys.stderr.write("build_assets: %s==%s required, %s installed\n"
+                             % (dist, pinned, installed or "not"))
+        sys.stderr.write("build_assets: pip install %s\n"
+                         % " ".join("%s==%s" % (d, p) for d, p, _ in missing))
+        if env is not None:
+            env.Exit(1)
+        sys.exit(1)
+    return tuple(importlib.import_module(module) for module, _ in COMPRESSORS.values())
+
+
+def minify(html):
+    """Conservative minifier: drops indentation, blank lines and whole-line
+    // and <!-- --> comments. Inline code is left untouched."""
+    html = re.sub(r"<!--(?!\[).*?-->", "", html, flags=re.S)
+    lines = []
+    for line in html.splitlines():
+        line = line.strip()
+        if not line or line.startswith("//"):
+            continue
+        lines.append(line)
+    return "\n".join(lines).encode("utf-8")
+
+
+def etag_of(blob):
+    return hashlib.sha1(blob).hexdigest()[:16]
+
+
+def c_array(symbol, name, blob):
+    out = ["//File: %s, Size: %d" % (name, len(blob))]
+    out.append("#define %s_len %d" % (symbol, len(blob)))
+    out.append("const uint8_t %s[] PROGMEM = {" % symbol)
+    for i in range(0, len(blob), 16):
+        out.append(" " + ", ".join("0x%02X" % b for b in blob[i:i + 16]) + ",")
+    out.append("};")
+    out.append("")
+    return out
+
+
+def build_header(header, pages, zopfli_gzip, brotli):
+    lines = [
+        "// Generated by scripts/build_assets.py from web/, do not edit.",
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    report = []
+    for source, prefix in pages:
+        with open(os.path.join(ROOT, source), encoding="utf-8") as f:
+            raw = f.read()
+        minified = minify(raw)
+        gz = zopfli_gzip.compress(minified, numiterations=100)
+        lines += c_array(prefix + "_gz", os.path.basename(source) + ".gz", gz)
+        lines.append('#define %s_gz_etag "\\"%s\\""' % (prefix, etag_of(gz)))
+        lines.append("")
+        br = None
+        if header in BROTLI:
+            br = brotli.compress(minified, quality=11, mode=brotli.MODE_TEXT)
+            lines += c_array(prefix + "_br", os.path.basename(source) + ".br", br)
+            lines.append('#define %s_br_etag "\\"%s\\""' % (prefix, etag_of(br)))
+            lines.append("")
+        report.append((source, len(raw.encode("utf-8")), len(minified), len(gz), len(br) if br else None))
+    return "\n".join(lines), report
+
+
+def write_if_changed(path, text):
+    try:
+        with open(path, encoding="utf-8") as f:
+            if f.read() == text:
+                return False
+    except FileNotFoundError:
+        pass
+    with open(path, "w", encoding="utf-8") as f:
+        f.write(text)
+    return True
+
+
+def main(out_dir, env=None):
+    zopfli_gzip, brotli = load_compressors(env)
+    os.makedirs(out_dir, exist_ok=True)
+    rows = []
+    for header, pages in BUNDLES.items():
+        text, report = build_header(header, pages, zopfli_gzip, brotli)
+        changed = write_if_changed(os.path.join(out_dir, header), text)
+        print("%s%s" % (header, " (updated)" if changed else ""))
+        rows += report
+
+    lines = ["%-30s %8s %8s %8s %8s" % ("page", "raw", "min", "gzip", "brotli")]
+    for source, raw, minified, gz, br in rows:
+        lines.append("%-30s %8d %8d %8d %8s" % (source, raw, minified, gz, br if br else "-"))
+    flash = sum(r[3] + (r[4] or 0) for r in rows)
+    lines.append("%-30s %8s %8s %8s %8d" % ("flash total", "", "", "", flash))
+    report = "\n".join(lines) + "\n"
+    print(report, end="")
+    write_if_changed(os.path.join(out_dir, SIZE_REPORT), report)
+
+
+# PlatformIO executes pre: scripts through SCons, which injects Import().
+if "Import" in globals():
+    Import("env")  # noqa: F821
+    assets = os.path.join(env.subst("$BUILD_DIR"), "assets")  # noqa: F821
+    main(assets, env)  # noqa: F821
+    env.Append(CPPPATH=[assets])  # noqa: F821
+elif __name__ == "__main__":
+    main(sys.argv[1] if len(sys.argv) > 1 else os.path.join(ROOT, ".pio", "assets"))
@@ -1201,6 +1201,9 @@ static esp_err_t index_handler(httpd_req_t *req)
     }
 }
 
+// Not called by the kiosk firmware: main.cpp serves the kiosk UI and its
+// /stream from the AsyncWebServer on port 80, the port camera_httpd would
+// bind, and the QR reader owns the camera. Kept for the camera tuning UI.
 void startCameraServer()
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
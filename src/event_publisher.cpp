@@ -0,0 +1,113 @@
+#include "event_publisher.h"
+
+EventPublisher::EventPublisher(size_t maxBacklog) : maxBacklog(maxBacklog)
+{
+	lock = xSemaphoreCreateMutex();
+}
+
+bool EventPublisher::addSubscriber(EventSubscriber *subscriber)
+{
+	xSemaphoreTake(lock, portMAX_DELAY);
+	bool added = subscriptionCount < EVENT_SUBSCRIBERS_MAX;
+	if (added)
+		subscriptions[subscriptionCount++] = {subscriber, 0};
+	xSemaphoreGive(lock);
+	return added;
+}
+
+void EventPublisher::removeSubscriber(EventSubscriber *subscriber)
+{
+	xSemaphoreTake(lock, portMAX_DELAY);
+	for (size_t i = 0; i < subscriptionCount; i++)
+	{
+		if (subscriptions[i].subscriber == subscriber)
+		{
+			subscriptions[i] = subscriptions[--subscriptionCount];
+			break;
+		}
+	}
+	xSemaphoreGive(lock);
+}
+
+// Called with the lock held. Returns -1 once EVENT_TYPES_MAX names are in use.
+int EventPublisher::typeIndex(const char *event)
+{
+	for (size_t i = 0; i < typeCount; i++)
+	{
+		if (!strcmp(messages[i].event, event))
+			return i;
+	}
+	if (typeCount == EVENT_TYPES_MAX)
+		return -1;
+	strncpy(messages[typeCount].event, event, sizeof(messages[typeCount].event) - 1);
+	messages[typeCount].event[sizeof(messages[typeCount].event) - 1] = 0;
+	return typeCount++;
+}
+
+// Sends held messages oldest first until the subscriber is backed up.
+// Called with the lock held.
+void EventPublisher::deliver(Subscription &subscription)
+{
+	while (subscription.pending)
+	{
+		if (subscription.subscriber->backlog() >= maxBacklog)
+			return;
+		int oldest = -1;
+		for (size_t i = 0; i < typeCount; i++)
+		{
+			if ((subscription.pending & (1u << i)) && (oldest < 0 || messages[i].seq < messages[oldest].seq))
+				oldest = i;
+		}
+		subscription.pending &= ~(1u << oldest);
+		subscription.subscriber->send(messages[oldest].event, messages[oldest].data, messages[oldest].id);
+		deliveredCount++;
+	}
+}
+
+void EventPublisher::publish(const char *event, const char *data)
+{
+	xSemaphoreTake(lock, portMAX_DELAY);
+	int type = typeIndex(event);
+	if (type < 0)
+	{
+		droppedCount++;
+		xSemaphoreGive(lock);
+		return;
+	}
+	Message &message = messages[type];
+	strncpy(message.data, data, sizeof(message.data) - 1);
+	message.data[sizeof(message.data) - 1] = 0;
+	message.id = millis();
+	message.seq = nextSeq++;
+	for (size_t i = 0; i < subscriptionCount; i++)
+	{
+		Subscription &subscription = subscriptions[i];
+		// The previous message of this type never went out: superseded.
+		if (subscription.pending & (1u << type))
+			droppedCount++;
+		subscription.pending |= 1u << type;
+		deliver(subscription);
+	}
+	xSemaphoreGive(lock);
+}
+
+void EventPublisher::pump()
+{
+	xSemaphoreTake(lock, portMAX_DELAY);
+	for (size_t i = 0; i < subscriptionCount; i++)
+		deliver(subscriptions[i]);
+	xSemaphoreGive(lock);
+}
+
+size_t EventPublisher::held()
+{
+	size_t count = 0;
+	xSemaphoreTake(lock, portMAX_DELAY);
+	for (size_t i = 0; i < subscriptionCount; i++)
+	{
+		for (uint32_t bits = subscriptions[i].pending; bits; bits &= bits - 1)
+			count++;
+	}
+	xSemaphoreGive(lock);
+	return count;
+}
@@ -0,0 +1,123 @@
+#include "frame_pool.h"
+
+FramePool framePool;
+
+bool FramePool::begin(size_t slotSize)
+{
+	for (int i = 0; i < FRAME_POOL_SLOTS; i++)
+	{
+		slots[i].buf = (uint8_t *)ps_malloc(slotSize);
+		if (!slots[i].buf)
+			slots[i].buf = (uint8_t *)malloc(slotSize);
+		if (!slots[i].buf)
+		{
+			// All or nothing: hand back what was allocated so far.
+			for (int j = 0; j < FRAME_POOL_SLOTS; j++)
+			{
+				if (j < i)
+					free(slots[j].buf);
+				slots[j].buf = nullptr;
+			}
+			return false;
+		}
+		slots[i].capacity = slotSize;
+		slots[i].len = 0;
+		slots[i].seq = 0;
+		slots[i].refs = 0;
+	}
+	return true;
+}
+
+FrameSlot *FramePool::acquireWrite()
+{
+	FrameSlot *slot = nullptr;
+	portENTER_CRITICAL(&mux);
+	for (int i = 0; i < FRAME_POOL_SLOTS; i++)
+	{
+		if (slots[i].buf && slots[i].refs == 0)
+		{
+			slot = &slots[i];
+			slot->refs = 1;
+			slot->len = 0;
+			break;
+		}
+	}
+	portEXIT_CRITICAL(&mux);
+	return slot;
+}
+
+void FramePool::publish(FrameSlot *slot)
+{
+	FrameSlot *old;
+	portENTER_CRITICAL(&mux);
+	// The writer's reference becomes the pool's reference to the latest frame.
+	slot->seq = nextSeq++;
+	old = latest;
+	latest = slot;
+	if (old)
+		old->refs--;
+	portEXIT_CRITICAL(&mux);
+}
+
+void FramePool::abort(FrameSlot *slot)
+{
+	portENTER_CRITICAL(&mux);
+	slot->len = 0;
+	slot->refs--;
+	portEXIT_CRITICAL(&mux);
+}
+
+FrameSlot *FramePool::borrowLatest()
+{
+	FrameSlot *slot;
+	portENTER_CRITICAL(&mux);
+	slot = latest;
+	if (slot)
+		slot->refs++;
+	portEXIT_CRITICAL(&mux);
+	return slot;
+}
+
+FrameSlot *FramePool::borrowNewer(uint32_t lastSeq)
+{
+	FrameSlot *slot = nullptr;
+	portENTER_CRITICAL(&mux);
+	// Wrap-safe: seq only grows, modulo 2^32.
+	if (latest && (int32_t)(latest->seq - lastSeq) > 0)
+	{
+		slot = latest;
+		slot->refs++;
+	}
+	portEXIT_CRITICAL(&mux);
+	return slot;
+}
+
+void FramePool::release(FrameSlot *slot)
+{
+	if (!slot)
+		return;
+	portENTER_CRITICAL(&mux);
+	slot->refs--;
+	portEXIT_CRITICAL(&mux);
+}
+
+void FramePool::clear()
+{
+	portENTER_CRITICAL(&mux);
+	if (latest)
+	{
+		latest->refs--;
+		latest = nullptr;
+	}
+	portEXIT_CRITICAL(&mux);
+}
+
+size_t FramePool::writeCallback(void *arg, size_t index, const void *data, size_t len)
+{
+	FrameSlot *slot = (FrameSlot *)arg;
+	if (index + len > slot->capacity)
+		return 0;
+	memcpy(slot->buf + index, data, len);
+	slot->len = index + len;
+	return len;
+}
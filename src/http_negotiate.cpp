@@ -0,0 +1,104 @@
+#include "http_negotiate.h"
+#include <strings.h>
+
+static const char *skipSpace(const char *p)
+{
+	while (*p == ' ' || *p == '\t')
+		p++;
+	return p;
+}
+
+// A weight ("0.5", "1", "0.000") in thousandths. Malformed weights count as
+// 1, the same as no weight at all.
+static int parseWeight(const char *p)
+{
+	if (*p != '0' && *p != '1')
+		return 1000;
+	int q = (*p++ - '0') * 1000;
+	if (*p == '.')
+	{
+		p++;
+		for (int scale = 100; scale && *p >= '0' && *p <= '9'; scale /= 10)
+			q += (*p++ - '0') * scale;
+	}
+	return min(q, 1000);
+}
+
+bool acceptsEncoding(const char *header, const char *coding)
+{
+	if (!header)
+		return false;
+	size_t codingLen = strlen(coding);
+	// Weight of the coding itself and of "*", -1 while not listed.
+	int exact = -1;
+	int any = -1;
+	const char *p = header;
+	while (*p)
+	{
+		// One element: coding *( OWS ";" OWS parameter ).
+		const char *end = strchr(p, ',');
+		if (!end)
+			end = p + strlen(p);
+		const char *name = skipSpace(p);
+		const char *nameEnd = name;
+		while (nameEnd < end && *nameEnd != ';' && *nameEnd != ' ' && *nameEnd != '\t')
+			nameEnd++;
+		int weight = 1000;
+		for (const char *param = nameEnd; (param = (const char *)memchr(param, ';', end - param));)
+		{
+			param = skipSpace(param + 1);
+			if (*param != 'q' && *param != 'Q')
+				continue;
+			const char *eq = skipSpace(param + 1);
+			if (*eq == '=')
+				weight = parseWeight(skipSpace(eq + 1));
+		}
+		size_t nameLen = nameEnd - name;
+		if (nameLen == codingLen && strncasecmp(name, coding, nameLen) == 0)
+			exact = weight;
+		else if (nameLen == 1 && *name == '*')
+			any = weight;
+		p = *end ? end + 1 : end;
+	}
+	return exact >= 0 ? exact > 0 : any > 0;
+}
+
+bool etagMatches(const char *header, const char *etag)
+{
+	if (!header || !etag)
+		return false;
+	if (strncmp(etag, "W/", 2) == 0)
+		etag += 2;
+	size_t etagLen = strlen(etag);
+	const char *p = header;
+	while (*p)
+	{
+		p = skipSpace(p);
+		if (*p == ',')
+		{
+			p++;
+			continue;
+		}
+		if (*p == '*')
+			return true;
+		if (strncmp(p, "W/", 2) == 0)
+			p += 2;
+		if (*p != '"')
+		{
+			// Not an entity-tag; skip the element.
+			p = strchr(p, ',');
+			if (!p)
+				break;
+			continue;
+		}
+		// Entity-tags may contain commas, so the list is split on quotes.
+		const char *close = strchr(p + 1, '"');
+		if (!close)
+			break;
+		size_t len = close + 1 - p;
+		if (len == etagLen && memcmp(p, etag, len) == 0)
+			return true;
+		p = close + 1;
+	}
+	return false;
+}
@@ -0,0 +1,97 @@
+#include "image_scale.h"
+
+// The word kernels treat a uint32_t as four pixels. Adding neighbouring
+// bytes into the two 16-bit lanes of (w & 0x00FF00FF) + ((w >> 8) & 0x00FF00FF)
+// leaves room for up to 257 pixels per lane, enough for a 4x4 block.
+#define LANE_MASK 0x00FF00FFu
+
+static inline uint32_t load32(const uint8_t *p)
+{
+	uint32_t w;
+	memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+// Sums horizontally adjacent byte pairs into two 16-bit lanes
+// (pixels 0+1 low, 2+3 high; little endian as on the ESP32).
+static inline uint32_t pairSums(uint32_t w)
+{
+	return (w & LANE_MASK) + ((w >> 8) & LANE_MASK);
+}
+
+static uint8_t blockMean(const uint8_t *src, int width, int x, int y, int factor)
+{
+	uint32_t sum = 0;
+	for (int dy = 0; dy < factor; dy++)
+		for (int dx = 0; dx < factor; dx++)
+			sum += src[(y + dy) * width + x + dx];
+	int n = factor * factor;
+	return (sum + n / 2) / n;
+}
+
+static void downscale2(const uint8_t *src, int width, int outW, int outH, uint8_t *dst)
+{
+	for (int oy = 0; oy < outH; oy++)
+	{
+		const uint8_t *r0 = src + (2 * oy) * width;
+		const uint8_t *r1 = r0 + width;
+		uint8_t *out = dst + oy * outW;
+		int ox = 0;
+		// Four output pixels from two words of each row.
+		for (; ox + 4 <= outW; ox += 4)
+		{
+			uint32_t a = (pairSums(load32(r0)) + pairSums(load32(r1)) + 0x00020002u) >> 2 & LANE_MASK;
+			uint32_t b = (pairSums(load32(r0 + 4)) + pairSums(load32(r1 + 4)) + 0x00020002u) >> 2 & LANE_MASK;
+			uint32_t packed = (a & 0xFF) | (a >> 8 & 0xFF00) | (b & 0xFF) << 16 | (b << 8 & 0xFF000000u);
+			memcpy(out + ox, &packed, sizeof(packed));
+			r0 += 8;
+			r1 += 8;
+		}
+		for (; ox < outW; ox++)
+			out[ox] = blockMean(src, width, 2 * ox, 2 * oy, 2);
+	}
+}
+
+static void downscale4(const uint8_t *src, int width, int outW, int outH, uint8_t *dst)
+{
+	for (int oy = 0; oy < outH; oy++)
+	{
+		const uint8_t *r0 = src + (4 * oy) * width;
+		uint8_t *out = dst + oy * outW;
+		// One output pixel per word of each of the four rows.
+		for (int ox = 0; ox < outW; ox++)
+		{
+			const uint8_t *p = r0 + 4 * ox;
+			uint32_t acc = pairSums(load32(p)) + pairSums(load32(p + width)) +
+						   pairSums(load32(p + 2 * width)) + pairSums(load32(p + 3 * width));
+			out[ox] = ((acc & 0xFFFF) + (acc >> 16) + 8) >> 4;
+		}
+	}
+}
+
+size_t downscaleGray(const uint8_t *src, int width, int height, int factor, uint8_t *dst)
+{
+	if (factor != 1 && factor != 2 && factor != 4)
+		return 0;
+	int outW = width / factor;
+	int outH = height / factor;
+	if (factor == 1)
+		memcpy(dst, src, (size_t)width * height);
+	else if (factor == 2)
+		downscale2(src, width, outW, outH, dst);
+	else
+		downscale4(src, width, outW, outH, dst);
+	return (size_t)outW * outH;
+}
+
+size_t downscaleGrayScalar(const uint8_t *src, int width, int height, int factor, uint8_t *dst)
+{
+	if (factor != 1 && factor != 2 && factor != 4)
+		return 0;
+	int outW = width / factor;
+	int outH = height / factor;
+	for (int oy = 0; oy < outH; oy++)
+		for (int ox = 0; ox < outW; ox++)
+			dst[oy * outW + ox] = blockMean(src, width, ox * factor, oy * factor, factor);
+	return (size_t)outW * outH;
+}
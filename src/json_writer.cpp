@@ -0,0 +1,166 @@
+#include "json_writer.h"
+
+JsonWriter::JsonWriter(char *buf, size_t size) : buf(buf), size(size)
+{
+	// Callers pass at least 3 bytes: "{}" and the NUL.
+	buf[len++] = '{';
+}
+
+// Appends n bytes if they fit in front of the reserved closing "}" + NUL.
+bool JsonWriter::put(const char *s, size_t n)
+{
+	if (n > size - 2 - len)
+	{
+		truncated = true;
+		return false;
+	}
+	memcpy(buf + len, s, n);
+	len += n;
+	return true;
+}
+
+// Writes ["," ]"key": plus room for an empty string value, or nothing.
+bool JsonWriter::beginField(const char *key)
+{
+	if (truncated)
+		return false;
+	size_t keyLen = strlen(key);
+	size_t need = (first ? 0 : 1) + keyLen + 3;
+	if (need + 2 > size - 2 - len)
+	{
+		truncated = true;
+		return false;
+	}
+	if (!first)
+		buf[len++] = ',';
+	buf[len++] = '"';
+	memcpy(buf + len, key, keyLen);
+	len += keyLen;
+	buf[len++] = '"';
+	buf[len++] = ':';
+	first = false;
+	return true;
+}
+
+// Escapes s into the buffer, keeping one byte for the closing quote. Stops
+// before an escape sequence or UTF-8 character that would not fit whole.
+void JsonWriter::putEscaped(const char *s)
+{
+	static const char hex[] = "0123456789abcdef";
+	for (const uint8_t *p = (const uint8_t *)s; *p;)
+	{
+		// Plain ASCII needs no escaping and is copied a run at a time.
+		const uint8_t *run = p;
+		while (*run >= 0x20 && *run < 0x80 && *run != '"' && *run != '\\')
+			run++;
+		if (run != p)
+		{
+			size_t n = run - p;
+			size_t room = size - 3 - len;
+			if (n > room)
+			{
+				memcpy(buf + len, p, room);
+				len += room;
+				truncated = true;
+				return;
+			}
+			memcpy(buf + len, p, n);
+			len += n;
+			p = run;
+			continue;
+		}
+		char esc[6];
+		const char *out = esc;
+		size_t n = 2;
+		esc[0] = '\\';
+		switch (*p)
+		{
+		case '"':
+			esc[1] = '"';
+			break;
+		case '\\':
+			esc[1] = '\\';
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		case '\b':
+			esc[1] = 'b';
+			break;
+		case '\f':
+			esc[1] = 'f';
+			break;
+		default:
+			if (*p < 0x20)
+			{
+				memcpy(esc + 1, "u00", 3);
+				esc[4] = hex[*p >> 4];
+				esc[5] = hex[*p & 0xF];
+				n = 6;
+			}
+			else
+			{
+				// Copy a UTF-8 sequence as one unit.
+				out = (const char *)p;
+				n = *p >= 0xF0 ? 4 : *p >= 0xE0 ? 3 : *p >= 0xC0 ? 2 : 1;
+				for (size_t i = 1; i < n; i++)
+				{
+					if (!p[i])
+					{
+						n = i;
+						break;
+					}
+				}
+			}
+			break;
+		}
+		if (n + 1 > size - 2 - len)
+		{
+			truncated = true;
+			return;
+		}
+		memcpy(buf + len, out, n);
+		len += n;
+		p += out == esc ? 1 : n;
+	}
+}
+
+JsonWriter &JsonWriter::field(const char *key, const char *value)
+{
+	if (!beginField(key))
+		return *this;
+	buf[len++] = '"';
+	putEscaped(value ? value : "");
+	buf[len++] = '"';
+	return *this;
+}
+
+JsonWriter &JsonWriter::field(const char *key, int value)
+{
+	char digits[12];
+	int n = snprintf(digits, sizeof(digits), "%d", value);
+	size_t mark = len;
+	bool wasFirst = first;
+	if (!beginField(key))
+		return *this;
+	if (!put(digits, n))
+	{
+		// A number is all or nothing.
+		len = mark;
+		first = wasFirst;
+	}
+	return *this;
+}
+
+const char *JsonWriter::finish()
+{
+	buf[len++] = '}';
+	buf[len] = 0;
+	return buf;
+}
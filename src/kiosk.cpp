@@ -0,0 +1,333 @@
+#include "kiosk.h"
+#include "rental_uplink.h"
+#include "rental_trace.h"
+#include "metrics.h"
+
+static FingerprintSensor *sensor = nullptr;
+static KioskPlatform *platform = nullptr;
+static uint32_t successDisplayMs = 0;
+
+// Every state change goes through kioskMachine. Each edge is taken by one
+// task; its hooks power the camera up or down, wake the tasks that work in
+// the new state and tell the browsers. No task is ever suspended from
+// outside: the fingerprint, QR and streaming tasks check the state
+// themselves and sleep on their notification while it is not theirs.
+static void leaveLocked(const char *payload);
+static void enterScanning(const char *payload);
+static void enterEnrolling(const char *payload);
+static void enterSuccess(const char *payload);
+static void leaveSuccess(const char *payload);
+static void enterLocked(const char *payload);
+
+constexpr Transition kioskTransitions[] = {
+	{LOCKED, UNLOCKED_SCANNING, leaveLocked, enterScanning},   // fingerprint task
+	{LOCKED, ENROLLING, nullptr, enterEnrolling},              // /start_enroll handler
+	{ENROLLING, LOCKED, nullptr, enterLocked},                 // enrollment task
+	{UNLOCKED_SCANNING, SUCCESS, nullptr, enterSuccess},       // QR task
+	{SUCCESS, LOCKED, leaveSuccess, enterLocked},              // QR task
+};
+static_assert(transitionsUnique(kioskTransitions, sizeof(kioskTransitions) / sizeof(kioskTransitions[0])), "duplicate edge in kioskTransitions");
+
+// Indexed by SystemState; also the state label on /metrics.
+static const char *const kioskStateNames[] = {"LOCKED", "SCANNING", "SUCCESS", "ENROLLING"};
+
+// State and status payload shared by the tasks and the async_tcp handlers.
+// Readers never block; see StateCell.
+StateCell kioskState(LOCKED);
+StateMachine kioskMachine(kioskState, kioskTransitions, sizeof(kioskTransitions) / sizeof(kioskTransitions[0]), kioskStateNames, sizeof(kioskStateNames) / sizeof(kioskStateNames[0]));
+
+TaskHandle_t fingerprintTaskHandle = NULL;
+TaskHandle_t qrCodeTaskHandle = NULL;
+TaskHandle_t enrollmentTaskHandle = NULL;
+
+volatile uint32_t fingerprintUartTransactions = 0;
+volatile uint32_t fingerprintUartPerMinute = 0;
+volatile uint32_t fingerprintMatchLatencyUs = 0;
+
+// The user of the rental in progress, -1 if none.
+static volatile int authenticatedUserId = -1;
+static volatile int enrollId = 0;
+// Held for every exchange with the fingerprint sensor: by the fingerprint
+// task per match attempt, by the enrollment task for its whole run.
+static SemaphoreHandle_t sensorLock = NULL;
+
+// Function for getting fingerprint
+static int getFingerprintIDez()
+{
+	int64_t start = esp_timer_get_time();
+	fingerprintUartTransactions++;
+	uint8_t p = sensor->getImage();
+	if (p != FINGERPRINT_OK)
+		return -1;
+	fingerprintUartTransactions++;
+	p = sensor->image2Tz();
+	if (p != FINGERPRINT_OK)
+		return -2;
+	fingerprintUartTransactions++;
+	p = sensor->fingerSearch();
+	if (p == FINGERPRINT_OK)
+	{
+		fingerprintMatchLatencyUs = esp_timer_get_time() - start;
+		return sensor->fingerID;
+	}
+	return -3;
+}
+
+// --- State machine hooks, see kioskTransitions ---
+
+// Fingerprint task, before SCANNING is published: a preview request may
+// wake the streaming task as soon as it is, so the camera has to be up.
+static void leaveLocked(const char *payload)
+{
+	platform->powerUp();
+}
+
+// Fingerprint task: wake the QR task (the platform wakes the preview). The
+// fingerprint task goes back to sleep on its own.
+static void enterScanning(const char *payload)
+{
+	platform->stateEntered(UNLOCKED_SCANNING, payload);
+	Serial.println("Waking Streaming and QR Code tasks...");
+	xTaskNotifyGive(qrCodeTaskHandle);
+	traceMark(currentTraceId, STAGE_RESUMED);
+}
+
+// /start_enroll handler. The enrollment task takes sensorLock, so it only
+// starts talking to the sensor once the fingerprint task is done with it.
+static void onEnrollmentTask(void *pvParameters);
+static void enterEnrolling(const char *payload)
+{
+	xTaskCreatePinnedToCore(onEnrollmentTask, "Enrollment", 4 * 1024, NULL, 2, &enrollmentTaskHandle, 1);
+}
+
+// QR task. The kiosk shows the part of the payload after the ';'. The
+// streaming task stops by itself once it sees the state.
+static void enterSuccess(const char *payload)
+{
+	const char *semi = strchr(payload, ';');
+	platform->stateEntered(SUCCESS, semi ? semi + 1 : payload);
+}
+
+// QR task, before LOCKED is published: once anyone can see LOCKED a new
+// match may wake everything up again, so the rental is cleared and the
+// camera powered down first.
+static void leaveSuccess(const char *payload)
+{
+	authenticatedUserId = -1;
+	currentTraceId = 0;
+	platform->powerDown();
+}
+
+// QR task after a rental, enrollment task after an enrollment: back to
+// LOCKED in place, without a reboot.
+static void enterLocked(const char *payload)
+{
+	platform->stateEntered(LOCKED, "");
+	Serial.println("System is LOCKED. Waiting for fingerprint...");
+	xTaskNotifyGive(fingerprintTaskHandle);
+}
+
+bool kioskStartEnroll(int id)
+{
+	if (kioskCurrentState() != LOCKED)
+		return false;
+	enrollId = id;
+	// A fingerprint match may have won the race since the check above.
+	return kioskMachine.transition(LOCKED, ENROLLING, "");
+}
+
+static void onEnrollmentTask(void *pvParameters)
+{
+	int id_to_enroll = enrollId;
+	xSemaphoreTake(sensorLock, portMAX_DELAY);
+	Serial.printf("Starting enrollment for ID #%d\n", id_to_enroll);
+
+	platform->sendEnrollStatus("go", "Place a finger on the sensor...");
+	while (sensor->getImage() != FINGERPRINT_OK)
+	{
+		vTaskDelay(50 / portTICK_PERIOD_MS);
+	}
+	uint8_t p = sensor->image2Tz(1);
+	if (p != FINGERPRINT_OK)
+	{
+		platform->sendEnrollStatus("error", "Error imaging finger. Please try again.");
+		goto cleanup_enroll;
+	}
+	Serial.println("Image 1 taken and converted.");
+	platform->sendEnrollStatus("wait", "Remove finger...");
+	vTaskDelay(1000);
+	while (sensor->getImage() != FINGERPRINT_NOFINGER)
+	{
+		vTaskDelay(50 / portTICK_PERIOD_MS);
+	}
+
+	platform->sendEnrollStatus("go", "Place the same finger again...");
+	while (sensor->getImage() != FINGERPRINT_OK)
+	{
+		vTaskDelay(50 / portTICK_PERIOD_MS);
+	}
+	p = sensor->image2Tz(2);
+	if (p != FINGERPRINT_OK)
+	{
+		platform->sendEnrollStatus("error", "Error imaging finger. Please try again.");
+		goto cleanup_enroll;
+	}
+	Serial.println("Image 2 taken and converted.");
+
+	p = sensor->createModel();
+	if (p != FINGERPRINT_OK)
+	{
+		platform->sendEnrollStatus("error", "Fingers do not match. Please try again.");
+		goto cleanup_enroll;
+	}
+	Serial.println("Model created.");
+
+	p = sensor->storeModel(id_to_enroll);
+	if (p != FINGERPRINT_OK)
+	{
+		platform->sendEnrollStatus("error", "Error storing fingerprint. Please try again.");
+		goto cleanup_enroll;
+	}
+	Serial.println("Fingerprint stored!");
+	platform->sendEnrollStatus("success", "Enrollment successful! Redirecting...");
+	vTaskDelay(2000);
+
+cleanup_enroll:
+	Serial.println("Enrollment task finished.");
+	xSemaphoreGive(sensorLock);
+	enrollmentTaskHandle = NULL;
+	kioskMachine.transition(ENROLLING, LOCKED, "");
+	vTaskDelete(NULL);
+}
+
+static void onFingerprintTask(void *pvParameters)
+{
+	uint32_t pollMs = FINGERPRINT_POLL_MIN_MS;
+	uint32_t minuteStart = millis();
+	uint32_t minuteBase = fingerprintUartTransactions;
+	while (true)
+	{
+		if (millis() - minuteStart >= 60000)
+		{
+			fingerprintUartPerMinute = fingerprintUartTransactions - minuteBase;
+			minuteBase = fingerprintUartTransactions;
+			minuteStart = millis();
+			Serial.printf("Fingerprint UART transactions/min: %u\n", fingerprintUartPerMinute);
+		}
+		// The sensor is only ours while LOCKED; enterLocked wakes us. A
+		// touch line, if there is one, wakes us on contact.
+		if (kioskCurrentState() != LOCKED || platform->sensorUntouched())
+		{
+			ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(60000));
+			continue;
+		}
+		// An enrollment may have started since the check above; it holds
+		// sensorLock until it is done, and the state tells us to back off.
+		xSemaphoreTake(sensorLock, portMAX_DELAY);
+		int finger_id = kioskCurrentState() == LOCKED ? getFingerprintIDez() : 0;
+		xSemaphoreGive(sensorLock);
+		if (finger_id > 0)
+		{
+			Serial.printf("Fingerprint match found. User ID: %d (match took %u us)\n", finger_id, fingerprintMatchLatencyUs);
+			authenticatedUserId = finger_id;
+			currentTraceId = traceBegin(esp_timer_get_time() - fingerprintMatchLatencyUs);
+			traceMark(currentTraceId, STAGE_MATCH);
+
+			// Fails if an enrollment started first.
+			if (!kioskMachine.transition(LOCKED, UNLOCKED_SCANNING, "Fingerprint OK. Scan QR Code..."))
+			{
+				authenticatedUserId = -1;
+				currentTraceId = 0;
+			}
+			pollMs = FINGERPRINT_POLL_MIN_MS;
+			continue;
+		}
+		// Back off while the sensor reports no finger, snap back on contact.
+		if (finger_id == -1)
+			pollMs = min<uint32_t>(pollMs + FINGERPRINT_POLL_MIN_MS, FINGERPRINT_POLL_MAX_MS);
+		else
+			pollMs = FINGERPRINT_POLL_MIN_MS;
+		vTaskDelay(pollMs / portTICK_PERIOD_MS);
+	}
+}
+
+bool processQrPayload(const char *qrPayload, int userId)
+{
+	Serial.printf("Processing QR Payload: %s for User ID: %d\n", qrPayload, userId);
+	const char *semi = strchr(qrPayload, ';');
+	if (!semi)
+	{
+		Serial.println("Invalid QR format: missing semicolon ';'");
+		return false;
+	}
+	const char *dash = strchr(semi + 1, '-');
+	if (!dash)
+	{
+		Serial.println("Invalid QR format: missing hyphen '-' in payload");
+		return false;
+	}
+	int laptopId = atoi(semi + 1);
+	if (laptopId == 0)
+	{
+		Serial.println("Failed to parse a valid laptop ID.");
+		return false;
+	}
+	Serial.printf("Parsed Record -> Laptop ID: %d, Name: %s\n", laptopId, dash + 1);
+	if (userId <= 0)
+	{
+		Serial.println("Invalid User ID, skipping Supabase update.");
+		return false;
+	}
+	if (!rentalUplinkEnqueue(laptopId, userId, currentTraceId))
+	{
+		Serial.println("Uplink queue full, dropping rental event.");
+		return false;
+	}
+	traceMark(currentTraceId, STAGE_QUEUED);
+	return true;
+}
+
+static void onQrCodeTask(void *pvParameters)
+{
+	char qrPayload[KIOSK_QR_PAYLOAD_MAX];
+	int64_t presentedUs;
+	while (true)
+	{
+		if (kioskCurrentState() != UNLOCKED_SCANNING)
+		{
+			// Woken by enterScanning. Codes decoded before that belong to
+			// the previous rental; one still in view is decoded again on the
+			// next frame.
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			while (platform->receiveQr(qrPayload, sizeof(qrPayload), 0, &presentedUs))
+			{
+			}
+			continue;
+		}
+		// The scanner queues a result as soon as a frame decodes, so there
+		// is nothing to poll for.
+		if (!platform->receiveQr(qrPayload, sizeof(qrPayload), portMAX_DELAY, &presentedUs))
+			continue;
+		traceMark(currentTraceId, STAGE_QR_DECODED);
+		Serial.printf("QR Payload Received: %s\n", qrPayload);
+		if (!kioskMachine.transition(UNLOCKED_SCANNING, SUCCESS, qrPayload))
+			continue;
+		metrics.qrPresentToSuccessMs.observe((esp_timer_get_time() - presentedUs) / 1000);
+		processQrPayload(qrPayload, authenticatedUserId);
+		Serial.printf("SUCCESS! Displaying payload for %u ms, then resetting.\n", successDisplayMs);
+		vTaskDelay(successDisplayMs / portTICK_PERIOD_MS);
+		kioskMachine.transition(SUCCESS, LOCKED, "");
+	}
+}
+
+bool kioskBegin(FingerprintSensor &fingerprintSensor, KioskPlatform &kioskPlatform, uint32_t displayMs)
+{
+	sensor = &fingerprintSensor;
+	platform = &kioskPlatform;
+	successDisplayMs = displayMs;
+	sensorLock = xSemaphoreCreateMutex();
+	if (!sensorLock)
+		return false;
+	return xTaskCreatePinnedToCore(onFingerprintTask, "Fingerprint", 4 * 1024, NULL, 1, &fingerprintTaskHandle, 1) == pdPASS &&
+		   xTaskCreatePinnedToCore(onQrCodeTask, "QRCode", 8 * 1024, NULL, 1, &qrCodeTaskHandle, 1) == pdPASS;
+}
@@ -0,0 +1,65 @@
+#include "laptop_toggle.h"
+#include <WiFi.h>
+#include "rental_trace.h"
+
+// PostgREST answers "[]" when the filter matched no row.
+static bool rowsAffected(int code, const String &response)
+{
+	return code >= 200 && code < 300 && response.indexOf('{') != -1;
+}
+
+bool laptopToggle(SupabaseClient &db, int mode, int laptop_id, int user_id, uint32_t event_id, uint32_t traceId)
+{
+	if (WiFi.status() != WL_CONNECTED)
+	{
+		Serial.println("WiFi not connected, deferring Supabase update.");
+		return false;
+	}
+	String response;
+	char payload[96];
+	int code;
+	if (mode == TOGGLE_MODE_RPC)
+	{
+		snprintf(payload, sizeof(payload), "{\"p_laptop_id\": %d, \"p_user_id\": %d, \"p_event\": %u}",
+				 laptop_id, user_id, (unsigned)event_id);
+		Serial.printf("Sending toggle RPC with payload: %s\n", payload);
+		code = db.post("/rest/v1/rpc/toggle_laptop_user", payload, response);
+		traceMark(traceId, STAGE_FIRST_RESPONSE);
+	}
+	else
+	{
+		// Checkout first: only matches while the laptop is free, so two
+		// kiosks racing on the same laptop cannot both claim it.
+		String path = "/rest/v1/laptop_acc?id=eq." + String(laptop_id);
+		String notApplied = "&last_event=neq." + String(event_id);
+		snprintf(payload, sizeof(payload), "{\"user_id\": %d, \"last_event\": %u}", user_id, (unsigned)event_id);
+		Serial.printf("Sending checkout PATCH with payload: %s\n", payload);
+		code = db.patch(path + "&user_id=is.null" + notApplied, payload, response);
+		traceMark(traceId, STAGE_FIRST_RESPONSE);
+		if (code >= 200 && code < 300 && !rowsAffected(code, response))
+		{
+			// Only matches if this user holds it; another kiosk's checkout
+			// that landed in between stays untouched.
+			snprintf(payload, sizeof(payload), "{\"user_id\": null, \"last_event\": %u}", (unsigned)event_id);
+			Serial.printf("Laptop already rented, sending return PATCH with payload: %s\n", payload);
+			code = db.patch(path + "&user_id=eq." + String(user_id) + notApplied, payload, response);
+		}
+	}
+	if (rowsAffected(code, response))
+	{
+		traceMark(traceId, STAGE_COMMITTED);
+		Serial.println("Supabase update successful.");
+		Serial.printf("Response: %s\n", response.c_str());
+	}
+	else if (code >= 200 && code < 300)
+	{
+		Serial.println("Event already applied, or laptop rented by another user or unknown; nothing changed.");
+	}
+	else
+	{
+		Serial.printf("Supabase update failed. HTTP Code: %d\n", code);
+		Serial.printf("Response: %s\n", response.c_str());
+	}
+	Serial.printf("Supabase TLS handshakes so far: %u\n", db.handshakes());
+	return code > 0 && code < 500;
+}
@@ -0,0 +1,62 @@
+#include "metrics.h"
+
+Metrics metrics;
+
+void metricWrite(Print &out, const char *name, const char *type, const char *help, double value, const char *labels)
+{
+	if (help)
+	{
+		out.printf("# HELP %s %s\n", name, help);
+		out.printf("# TYPE %s %s\n", name, type);
+	}
+	if (labels)
+		out.printf("%s{%s} %.15g\n", name, labels, value);
+	else
+		out.printf("%s %.15g\n", name, value);
+}
+
+void Histogram::setBounds(std::initializer_list<uint32_t> upperBounds)
+{
+	buckets = 0;
+	for (uint32_t bound : upperBounds)
+	{
+		if (buckets == HISTOGRAM_MAX_BUCKETS)
+			break;
+		bounds[buckets++] = bound;
+	}
+}
+
+void Histogram::observe(uint32_t value)
+{
+	size_t i = 0;
+	while (i < buckets && value > bounds[i])
+		i++;
+	metricAdd(counts[i]);
+	metricAdd(sum, value);
+}
+
+void Histogram::write(Print &out, const char *name, const char *help, const char *labels) const
+{
+	char sample[64];
+	char le[96];
+	if (help)
+	{
+		out.printf("# HELP %s %s\n", name, help);
+		out.printf("# TYPE %s histogram\n", name);
+	}
+	snprintf(sample, sizeof(sample), "%s_bucket", name);
+	uint32_t cumulative = 0;
+	for (size_t i = 0; i <= buckets; i++)
+	{
+		cumulative += metricGet(counts[i]);
+		if (i < buckets)
+			snprintf(le, sizeof(le), "%s%sle=\"%u\"", labels ? labels : "", labels ? "," : "", (unsigned)bounds[i]);
+		else
+			snprintf(le, sizeof(le), "%s%sle=\"+Inf\"", labels ? labels : "", labels ? "," : "");
+		metricWrite(out, sample, nullptr, nullptr, cumulative, le);
+	}
+	snprintf(sample, sizeof(sample), "%s_sum", name);
+	metricWrite(out, sample, nullptr, nullptr, metricGet(sum), labels);
+	snprintf(sample, sizeof(sample), "%s_count", name);
+	metricWrite(out, sample, nullptr, nullptr, cumulative, labels);
+}
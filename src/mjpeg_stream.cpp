@@ -0,0 +1,126 @@
+#include "mjpeg_stream.h"
+#include "stream_format.h"
+
+MjpegHub mjpegHub;
+
+MjpegStream::MjpegStream(FramePool &pool, MjpegSink &sink, RateController *rate)
+	: pool(pool), sink(sink), rate(rate)
+{
+}
+
+MjpegStream::~MjpegStream()
+{
+	if (slot)
+		pool.release(slot);
+}
+
+size_t MjpegStream::fill(uint8_t *buffer, size_t maxLen)
+{
+	if (!slot)
+	{
+		if (ending)
+			return 0;
+		slot = pool.borrowNewer(lastSeq);
+		if (!slot)
+		{
+			waiting = true;
+			return MJPEG_TRY_AGAIN;
+		}
+		lastSeq = slot->seq;
+		offset = 0;
+		int blen = snprintf(header, sizeof(header), "%s", _STREAM_BOUNDARY);
+		headerLen = blen + snprintf(header + blen, sizeof(header) - blen, _STREAM_PART,
+									(unsigned)slot->len, (int)slot->timestamp.tv_sec, (int)slot->timestamp.tv_usec);
+	}
+	waiting = false;
+
+	size_t written = 0;
+	if (offset < headerLen)
+	{
+		size_t n = headerLen - offset;
+		if (n > maxLen)
+			n = maxLen;
+		memcpy(buffer, header + offset, n);
+		offset += n;
+		written += n;
+	}
+	if (written < maxLen && offset >= headerLen)
+	{
+		size_t jpgOffset = offset - headerLen;
+		size_t n = slot->len - jpgOffset;
+		if (n > maxLen - written)
+			n = maxLen - written;
+		memcpy(buffer + written, slot->buf + jpgOffset, n);
+		offset += n;
+		written += n;
+	}
+	if (offset == headerLen + slot->len)
+	{
+		int64_t now = esp_timer_get_time();
+		if (rate && lastSentUs)
+			rate->onFrameSent(slot->len, (uint32_t)(now - lastSentUs));
+		lastSentUs = now;
+		parts++;
+		pool.release(slot);
+		slot = nullptr;
+	}
+	return written;
+}
+
+bool MjpegHub::begin()
+{
+	mutex = xSemaphoreCreateRecursiveMutex();
+	return mutex != NULL;
+}
+
+void MjpegHub::lock()
+{
+	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+}
+
+void MjpegHub::unlock()
+{
+	xSemaphoreGiveRecursive(mutex);
+}
+
+void MjpegHub::add(MjpegStream *stream)
+{
+	lock();
+	stream->next = streams;
+	streams = stream;
+	unlock();
+}
+
+void MjpegHub::remove(MjpegStream *stream)
+{
+	lock();
+	for (MjpegStream **at = &streams; *at; at = &(*at)->next)
+	{
+		if (*at == stream)
+		{
+			*at = stream->next;
+			break;
+		}
+	}
+	unlock();
+}
+
+int MjpegHub::wake()
+{
+	int resumed = 0;
+	lock();
+	// A stream may end, and remove itself, from inside resume().
+	MjpegStream *next;
+	for (MjpegStream *stream = streams; stream; stream = next)
+	{
+		next = stream->next;
+		if (stream->waiting)
+		{
+			stream->waiting = false;
+			stream->sink.resume();
+			resumed++;
+		}
+	}
+	unlock();
+	return resumed;
+}
@@ -0,0 +1,39 @@
+#include "qr_handoff.h"
+
+struct QrResult
+{
+	char payload[QR_HANDOFF_PAYLOAD_MAX];
+	int64_t presentedUs;
+};
+
+static QueueHandle_t results;
+
+bool qrHandoffBegin()
+{
+	if (!results)
+		results = xQueueCreate(QR_HANDOFF_DEPTH, sizeof(QrResult));
+	return results != NULL;
+}
+
+bool qrScannerPublish(const char *payload, size_t len, int64_t presentedUs)
+{
+	// Only the scan task publishes, so one static copy is enough.
+	static QrResult result;
+	len = min(len, sizeof(result.payload) - 1);
+	memcpy(result.payload, payload, len);
+	result.payload[len] = 0;
+	result.presentedUs = presentedUs;
+	return xQueueSend(results, &result, 0) == pdTRUE;
+}
+
+bool qrScannerReceive(char *payload, size_t size, TickType_t timeout, int64_t *presentedUs)
+{
+	// Only the kiosk's QR task receives.
+	static QrResult result;
+	if (xQueueReceive(results, &result, timeout) != pdTRUE)
+		return false;
+	snprintf(payload, size, "%s", result.payload);
+	if (presentedUs)
+		*presentedUs = result.presentedUs;
+	return true;
+}
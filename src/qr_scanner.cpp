@@ -0,0 +1,110 @@
+#include "qr_scanner.h"
+#include "quirc_decoder.h"
+#include "metrics.h"
+
+static FramePool *volatile framesOut = nullptr;
+
+// qrScannerSleep() raises sleepRequested and waits on parked; the task
+// then blocks on its notification until qrScannerWake().
+TaskHandle_t qrScanTaskHandle = NULL;
+static SemaphoreHandle_t parked;
+static volatile bool sleepRequested = false;
+static volatile int64_t wakeUs = 0;
+
+static QuircDecoder decoder;
+static QrTracker tracker(decoder);
+static int64_t presentedUs;
+
+static void publishFrame(const camera_fb_t *fb)
+{
+	FramePool *pool = framesOut;
+	if (!pool)
+		return;
+	FrameSlot *slot = pool->acquireWrite();
+	if (!slot)
+		return;
+	if (fb->len > slot->capacity)
+	{
+		pool->abort(slot);
+		return;
+	}
+	memcpy(slot->buf, fb->buf, fb->len);
+	slot->len = fb->len;
+	slot->width = fb->width;
+	slot->height = fb->height;
+	slot->timestamp = fb->timestamp;
+	pool->publish(slot);
+}
+
+static void scanTask(void *arg)
+{
+	while (true)
+	{
+		if (sleepRequested)
+		{
+			// Holding no frame buffer, so the camera can be deinitialized.
+			tracker.reset();
+			xSemaphoreGive(parked);
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+			continue;
+		}
+		camera_fb_t *fb = esp_camera_fb_get();
+		int64_t capturedUs = esp_timer_get_time();
+		if (!fb)
+		{
+			vTaskDelay(10 / portTICK_PERIOD_MS);
+			continue;
+		}
+		if (fb->format != PIXFORMAT_GRAYSCALE)
+		{
+			esp_camera_fb_return(fb);
+			vTaskDelay(100 / portTICK_PERIOD_MS);
+			continue;
+		}
+		if (wakeUs)
+		{
+			metrics.wakeToFirstFrameMs.observe((capturedUs - wakeUs) / 1000);
+			wakeUs = 0;
+		}
+		publishFrame(fb);
+
+		bool wasTracking = tracker.tracking();
+		QrFound found = tracker.scan(fb->buf, fb->width, fb->height);
+		if (found.located && !wasTracking)
+			presentedUs = capturedUs;
+		esp_camera_fb_return(fb);
+
+		if (found.decoded)
+			qrScannerPublish(decoder.payload, decoder.payloadLen, presentedUs);
+	}
+}
+
+bool qrScannerBegin(BaseType_t core)
+{
+	parked = xSemaphoreCreateBinary();
+	if (!decoder.begin() || !qrHandoffBegin() || !parked)
+		return false;
+	return xTaskCreatePinnedToCore(scanTask, "QRScan", QR_SCANNER_STACK_SIZE, NULL, QR_SCANNER_PRIORITY, &qrScanTaskHandle, core) == pdPASS;
+}
+
+void qrScannerSleep()
+{
+	if (sleepRequested)
+		return;
+	sleepRequested = true;
+	xSemaphoreTake(parked, portMAX_DELAY);
+}
+
+void qrScannerWake(int64_t wokenUs)
+{
+	if (!sleepRequested)
+		return;
+	wakeUs = wokenUs;
+	sleepRequested = false;
+	xTaskNotifyGive(qrScanTaskHandle);
+}
+
+void qrScannerPublishFrames(FramePool *pool)
+{
+	framesOut = pool;
+}
@@ -0,0 +1,64 @@
+#include "qr_tracker.h"
+#include "metrics.h"
+
+QrRegion qrRoiAround(const QrRegion &code, int frameW, int frameH)
+{
+	int mx = code.w * QR_ROI_MARGIN_PCT / 100;
+	int my = code.h * QR_ROI_MARGIN_PCT / 100;
+	int w = min(frameW, (code.w + 2 * mx + QR_ROI_QUANTUM - 1) / QR_ROI_QUANTUM * QR_ROI_QUANTUM);
+	int h = min(frameH, (code.h + 2 * my + QR_ROI_QUANTUM - 1) / QR_ROI_QUANTUM * QR_ROI_QUANTUM);
+	int x = max(0, min(code.x + code.w / 2 - w / 2, frameW - w));
+	int y = max(0, min(code.y + code.h / 2 - h / 2, frameH - h));
+	return {x, y, w, h};
+}
+
+QrFound QrTracker::scan(const uint8_t *frame, int width, int height)
+{
+	QrFound found = {false, false, {0, 0, 0, 0}};
+	bool full = !tracked;
+	scannedPixels = 0;
+	if (tracked)
+	{
+		int64_t start = esp_timer_get_time();
+		found = decoder.decode(frame, width, height, roi);
+		metrics.qrDecodeRoiUs.observe(esp_timer_get_time() - start);
+		scannedPixels += roi.w * roi.h;
+		if (!found.located)
+		{
+			metricAdd(metrics.qrRoiFallbacks);
+			full = true;
+		}
+		else if (found.decoded)
+		{
+			misses = 0;
+		}
+		else if (++misses >= QR_ROI_MAX_MISSES)
+		{
+			metricAdd(metrics.qrRoiForcedScans);
+			stuck = true;
+			full = true;
+		}
+	}
+	if (full)
+	{
+		int64_t start = esp_timer_get_time();
+		QrRegion whole = {0, 0, width, height};
+		QrFound wide = decoder.decode(frame, width, height, whole);
+		metrics.qrDecodeFullUs.observe(esp_timer_get_time() - start);
+		scannedPixels += width * height;
+		misses = 0;
+		if (wide.located || !found.located)
+			found = wide;
+	}
+	// After a forced scan, stay on whole frames until something decodes or
+	// the view is empty: the forced pass may report the same undecodable
+	// code again while a readable one is blurred in that frame.
+	if (found.decoded || !found.located)
+		stuck = false;
+	// Otherwise follow the code even while it does not decode yet (blur,
+	// partly out of frame); lose it once a full-frame pass finds nothing.
+	tracked = found.located && !stuck;
+	if (tracked)
+		roi = qrRoiAround(found.where, width, height);
+	return found;
+}
@@ -0,0 +1,79 @@
+#include "quirc_decoder.h"
+#include "quirc/quirc.h"
+
+bool QuircDecoder::begin()
+{
+	full.q = quirc_new();
+	roi.q = quirc_new();
+	return full.q && roi.q;
+}
+
+// Resizes the instance only when the geometry changes, then copies the
+// region into its image.
+bool QuircDecoder::load(Instance &in, int w, int h)
+{
+	if (in.w != w || in.h != h)
+	{
+		if (quirc_resize(in.q, w, h) < 0)
+		{
+			in.w = in.h = 0;
+			return false;
+		}
+		in.w = w;
+		in.h = h;
+	}
+	return true;
+}
+
+static void boundsOf(const struct quirc_code &code, int offX, int offY, QrRegion &out)
+{
+	int minX = code.corners[0].x, maxX = minX;
+	int minY = code.corners[0].y, maxY = minY;
+	for (int i = 1; i < 4; i++)
+	{
+		minX = min(minX, code.corners[i].x);
+		maxX = max(maxX, code.corners[i].x);
+		minY = min(minY, code.corners[i].y);
+		maxY = max(maxY, code.corners[i].y);
+	}
+	out = {offX + minX, offY + minY, maxX - minX + 1, maxY - minY + 1};
+}
+
+QrFound QuircDecoder::decode(const uint8_t *frame, int width, int height, const QrRegion &region)
+{
+	// Kept off the stack: quirc_data alone is several KB.
+	static struct quirc_code code;
+	static struct quirc_data data;
+	QrFound found = {false, false, {0, 0, 0, 0}};
+	bool whole = region.w == width && region.h == height;
+	Instance &in = whole ? full : roi;
+	if (!load(in, region.w, region.h))
+		return found;
+
+	uint8_t *image = quirc_begin(in.q, NULL, NULL);
+	const uint8_t *src = frame + region.y * width + region.x;
+	if (whole)
+		memcpy(image, frame, width * height);
+	else
+		for (int row = 0; row < region.h; row++)
+			memcpy(image + row * region.w, src + row * width, region.w);
+	quirc_end(in.q);
+
+	int count = quirc_count(in.q);
+	for (int i = 0; i < count; i++)
+	{
+		quirc_extract(in.q, i, &code);
+		found.located = true;
+		boundsOf(code, region.x, region.y, found.where);
+		if (quirc_decode(&code, &data) == QUIRC_SUCCESS)
+		{
+			payloadLen = min<int>(data.payload_len, sizeof(payload) - 1);
+			memcpy(payload, data.payload, payloadLen);
+			payload[payloadLen] = 0;
+			dataType = data.data_type;
+			found.decoded = true;
+			return found;
+		}
+	}
+	return found;
+}
@@ -0,0 +1,46 @@
+#include "rate_controller.h"
+
+#define RATE_WINDOW_FRAMES 10
+#define RATE_QUALITY_DOWN 6
+#define RATE_QUALITY_UP 2
+
+RateController::RateController(uint8_t initialQuality, uint8_t minQuality, uint8_t maxQuality,
+							   uint8_t targetFps, uint32_t targetKbps)
+	: minQuality(minQuality), maxQuality(maxQuality), targetFps(targetFps),
+	  targetKbps(targetKbps), currentQuality(initialQuality)
+{
+}
+
+void RateController::onFrameSent(size_t frameBytes, uint32_t intervalUs)
+{
+	portENTER_CRITICAL(&mux);
+	frames++;
+	bytes += frameBytes;
+	intervalSumUs += intervalUs;
+	worstIntervalUs = max(worstIntervalUs, intervalUs);
+	if (frames >= RATE_WINDOW_FRAMES)
+		evaluate();
+	portEXIT_CRITICAL(&mux);
+}
+
+// Multiplicative-ish decrease when the slowest viewer misses the target,
+// slow additive increase while there is headroom.
+void RateController::evaluate()
+{
+	uint32_t targetIntervalUs = 1000000 / targetFps;
+	uint32_t avgIntervalUs = intervalSumUs / frames;
+	uint32_t kbps = intervalSumUs ? (uint32_t)((uint64_t)bytes * 8000 / intervalSumUs) : 0;
+
+	bool behind = worstIntervalUs > targetIntervalUs * 5 / 4 || kbps > targetKbps;
+	bool headroom = avgIntervalUs <= targetIntervalUs && kbps < targetKbps * 7 / 10;
+
+	if (behind && currentQuality > minQuality)
+		currentQuality = max<int>(minQuality, currentQuality - RATE_QUALITY_DOWN);
+	else if (headroom && currentQuality < maxQuality)
+		currentQuality = min<int>(maxQuality, currentQuality + RATE_QUALITY_UP);
+
+	frames = 0;
+	bytes = 0;
+	intervalSumUs = 0;
+	worstIntervalUs = 0;
+}
@@ -0,0 +1,106 @@
+#include "rental_trace.h"
+#include "esp_timer.h"
+
+struct RentalTrace
+{
+	uint32_t id;
+	int64_t at[STAGE_COUNT];
+};
+
+static const char *stageNames[STAGE_COUNT] = {
+	"touch", "match", "resumed", "first_frame", "qr_decoded",
+	"queued", "uplink_start", "first_response", "committed"};
+
+static RentalTrace traces[RENTAL_TRACE_DEPTH];
+static uint32_t nextId = 1;
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+volatile uint32_t currentTraceId = 0;
+
+uint32_t traceBegin(int64_t touchUs)
+{
+	portENTER_CRITICAL(&traceMux);
+	uint32_t id = nextId++;
+	RentalTrace &trace = traces[id % RENTAL_TRACE_DEPTH];
+	memset(trace.at, 0, sizeof(trace.at));
+	trace.id = id;
+	trace.at[STAGE_TOUCH] = touchUs;
+	portEXIT_CRITICAL(&traceMux);
+	return id;
+}
+
+void traceMark(uint32_t id, TraceStage stage)
+{
+	if (id == 0)
+		return;
+	int64_t now = esp_timer_get_time();
+	portENTER_CRITICAL(&traceMux);
+	RentalTrace &trace = traces[id % RENTAL_TRACE_DEPTH];
+	if (trace.id == id && trace.at[stage] == 0)
+		trace.at[stage] = now;
+	portEXIT_CRITICAL(&traceMux);
+}
+
+static void sortValues(int32_t *values, size_t count)
+{
+	for (size_t i = 1; i < count; i++)
+	{
+		int32_t v = values[i];
+		size_t j = i;
+		for (; j > 0 && values[j - 1] > v; j--)
+			values[j] = values[j - 1];
+		values[j] = v;
+	}
+}
+
+static void printPercentiles(Print &out, const char *from, const char *to, int32_t *values, size_t count)
+{
+	if (count == 0)
+		return;
+	sortValues(values, count);
+	out.printf("%-14s -> %-14s n=%-3u p50=%7.1f p90=%7.1f p99=%7.1f max=%7.1f ms\n", from, to, (unsigned)count,
+			   values[count * 50 / 100] / 1000.0, values[count * 90 / 100] / 1000.0,
+			   values[count * 99 / 100] / 1000.0, values[count - 1] / 1000.0);
+}
+
+void traceReport(Print &out)
+{
+	static RentalTrace snapshot[RENTAL_TRACE_DEPTH];
+	int32_t values[RENTAL_TRACE_DEPTH];
+
+	portENTER_CRITICAL(&traceMux);
+	memcpy(snapshot, traces, sizeof(snapshot));
+	portEXIT_CRITICAL(&traceMux);
+
+	// Each stage is measured from the closest earlier stage that was
+	// recorded, so a skipped stage does not hide the time spent. Rentals
+	// that skipped stages get their own row, labelled with the stage they
+	// were actually measured from.
+	for (int stage = STAGE_MATCH; stage < STAGE_COUNT; stage++)
+	{
+		for (int from = stage - 1; from >= STAGE_TOUCH; from--)
+		{
+			size_t count = 0;
+			for (int i = 0; i < RENTAL_TRACE_DEPTH; i++)
+			{
+				const RentalTrace &trace = snapshot[i];
+				if (trace.id == 0 || trace.at[stage] == 0)
+					continue;
+				int prev = stage - 1;
+				while (prev > STAGE_TOUCH && trace.at[prev] == 0)
+					prev--;
+				if (prev == from)
+					values[count++] = (int32_t)(trace.at[stage] - trace.at[prev]);
+			}
+			printPercentiles(out, stageNames[from], stageNames[stage], values, count);
+		}
+	}
+
+	size_t count = 0;
+	for (int i = 0; i < RENTAL_TRACE_DEPTH; i++)
+	{
+		const RentalTrace &trace = snapshot[i];
+		if (trace.id != 0 && trace.at[STAGE_COMMITTED] != 0)
+			values[count++] = (int32_t)(trace.at[STAGE_COMMITTED] - trace.at[STAGE_TOUCH]);
+	}
+	printPercentiles(out, stageNames[STAGE_TOUCH], stageNames[STAGE_COMMITTED], values, count);
+}
@@ -0,0 +1,160 @@
+#include "rental_uplink.h"
+#include <WiFi.h>
+#include <Preferences.h>
+
+#ifndef UPLINK_BACKOFF_MIN_MS
+#define UPLINK_BACKOFF_MIN_MS 1000
+#endif
+#ifndef UPLINK_BACKOFF_MAX_MS
+#define UPLINK_BACKOFF_MAX_MS 60000
+#endif
+
+static QueueHandle_t uplinkQueue = NULL;
+static RentalDeliverFn deliverFn = NULL;
+static Preferences prefs;
+
+// Owned by the uplink task only.
+static RentalEvent pending[RENTAL_UPLINK_CAPACITY];
+static volatile size_t pendingCount = 0;
+static uint32_t nextEventId = 0;
+
+// What "events" held before events carried an id.
+struct LegacyRentalEvent
+{
+	int laptopId;
+	int userId;
+	uint32_t traceId;
+};
+
+static uint32_t takeEventId()
+{
+	uint32_t id = nextEventId++;
+	if (nextEventId == 0)
+		nextEventId = 1;
+	return id;
+}
+
+static void persistPending()
+{
+	prefs.putBytes("next_event", &nextEventId, sizeof(nextEventId));
+	if (pendingCount == 0)
+		prefs.remove("batch");
+	else
+		prefs.putBytes("batch", pending, pendingCount * sizeof(RentalEvent));
+}
+
+static void loadPending()
+{
+	// Ids carry on from the last boot. A fresh device starts at a random
+	// point so two kiosks are unlikely to ever reuse each other's ids.
+	if (prefs.getBytes("next_event", &nextEventId, sizeof(nextEventId)) != sizeof(nextEventId))
+		nextEventId = esp_random();
+	if (nextEventId == 0)
+		nextEventId = 1;
+
+	size_t len = prefs.getBytesLength("batch");
+	if (len > 0 && len % sizeof(RentalEvent) == 0 && len <= sizeof(pending))
+	{
+		prefs.getBytes("batch", pending, len);
+		pendingCount = len / sizeof(RentalEvent);
+	}
+	len = prefs.getBytesLength("events");
+	if (len > 0 && len % sizeof(LegacyRentalEvent) == 0 && len <= sizeof(LegacyRentalEvent) * RENTAL_UPLINK_CAPACITY)
+	{
+		LegacyRentalEvent legacy[RENTAL_UPLINK_CAPACITY];
+		prefs.getBytes("events", legacy, len);
+		for (size_t i = 0; i < len / sizeof(LegacyRentalEvent) && pendingCount < RENTAL_UPLINK_CAPACITY; i++)
+		{
+			RentalEvent event = {legacy[i].laptopId, legacy[i].userId, 0, takeEventId()};
+			pending[pendingCount++] = event;
+		}
+		prefs.remove("events");
+		persistPending();
+	}
+	// Trace ids do not survive a reboot.
+	for (size_t i = 0; i < pendingCount; i++)
+		pending[i].traceId = 0;
+	if (pendingCount > 0)
+		Serial.printf("Uplink: restored %u undelivered rental event(s)\n", (unsigned)pendingCount);
+}
+
+// Moves everything currently queued into the pending batch. Returns at once
+// when the batch is already full, whatever the wait.
+static bool drainQueue(TickType_t wait)
+{
+	bool added = false;
+	RentalEvent event;
+	while (pendingCount < RENTAL_UPLINK_CAPACITY && xQueueReceive(uplinkQueue, &event, wait) == pdTRUE)
+	{
+		event.eventId = takeEventId();
+		pending[pendingCount++] = event;
+		added = true;
+		wait = 0;
+	}
+	return added;
+}
+
+static void onUplinkTask(void *pvParameters)
+{
+	uint32_t backoff = UPLINK_BACKOFF_MIN_MS;
+	while (true)
+	{
+		if (drainQueue(pendingCount == 0 ? portMAX_DELAY : 0))
+			persistPending();
+
+		size_t delivered = 0;
+		if (WiFi.status() == WL_CONNECTED)
+		{
+			while (delivered < pendingCount && deliverFn(pending[delivered]))
+				delivered++;
+		}
+		if (delivered > 0)
+		{
+			memmove(pending, pending + delivered, (pendingCount - delivered) * sizeof(RentalEvent));
+			pendingCount -= delivered;
+			persistPending();
+		}
+
+		if (pendingCount == 0)
+		{
+			backoff = UPLINK_BACKOFF_MIN_MS;
+			continue;
+		}
+		Serial.printf("Uplink: %u event(s) pending, retrying in %u ms\n", (unsigned)pendingCount, backoff);
+		// Sit out the whole backoff; events arriving meanwhile join the batch
+		// until it is full, then just sleep.
+		bool added = false;
+		uint32_t start = millis(), elapsed;
+		while ((elapsed = millis() - start) < backoff)
+		{
+			if (pendingCount == RENTAL_UPLINK_CAPACITY)
+				vTaskDelay((backoff - elapsed) / portTICK_PERIOD_MS);
+			else
+				added |= drainQueue((backoff - elapsed) / portTICK_PERIOD_MS);
+		}
+		if (added)
+			persistPending();
+		backoff = min<uint32_t>(backoff * 2, UPLINK_BACKOFF_MAX_MS);
+	}
+}
+
+bool rentalUplinkBegin(RentalDeliverFn deliver)
+{
+	deliverFn = deliver;
+	uplinkQueue = xQueueCreate(RENTAL_UPLINK_CAPACITY, sizeof(RentalEvent));
+	if (!uplinkQueue || !prefs.begin("uplink", false))
+		return false;
+	loadPending();
+	return xTaskCreate(onUplinkTask, "Uplink", 8 * 1024, NULL, 1, NULL) == pdPASS;
+}
+
+bool rentalUplinkEnqueue(int laptopId, int userId, uint32_t traceId)
+{
+	RentalEvent event = {laptopId, userId, traceId, 0};
+	return uplinkQueue && xQueueSend(uplinkQueue, &event, 0) == pdTRUE;
+}
+
+size_t rentalUplinkPending()
+{
+	return pendingCount + (uplinkQueue ? uxQueueMessagesWaiting(uplinkQueue) : 0);
+}
@@ -0,0 +1,40 @@
+#include "state_cell.h"
+
+StateCell::StateCell(int initialState) : currentState(initialState)
+{
+	snapshot.state = initialState;
+	snapshot.version = 0;
+	snapshot.payload[0] = 0;
+}
+
+// An odd sequence number marks a write in progress.
+void StateCell::publish(int state, const char *payload)
+{
+	portENTER_CRITICAL(&writeMux);
+	uint32_t s = seq.load(std::memory_order_relaxed);
+	seq.store(s + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	snapshot.state = state;
+	snapshot.version++;
+	strncpy(snapshot.payload, payload ? payload : "", sizeof(snapshot.payload) - 1);
+	snapshot.payload[sizeof(snapshot.payload) - 1] = 0;
+	currentState.store(state, std::memory_order_release);
+	seq.store(s + 2, std::memory_order_release);
+	portEXIT_CRITICAL(&writeMux);
+}
+
+void StateCell::read(StateSnapshot &out) const
+{
+	while (true)
+	{
+		uint32_t begin = seq.load(std::memory_order_acquire);
+		// A writer holds the critical section on the other core only for
+		// the length of one copy.
+		if (begin & 1)
+			continue;
+		memcpy(&out, &snapshot, sizeof(out));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (seq.load(std::memory_order_relaxed) == begin)
+			return;
+	}
+}
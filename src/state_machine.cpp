@@ -0,0 +1,114 @@
+#include "state_machine.h"
+
+StateMachine::StateMachine(StateCell &cell, const Transition *table, size_t count, const char *const *stateNames, size_t stateCount)
+	: cell(cell), table(table), count(count), stateNames(stateNames), stateCount(stateCount < STATE_MACHINE_MAX_STATES ? stateCount : STATE_MACHINE_MAX_STATES), enteredMs(millis())
+{
+	lock = xSemaphoreCreateMutex();
+	entering = xSemaphoreCreateMutex();
+	for (size_t i = 0; i < this->stateCount; i++)
+		dwellSeconds[i].setBounds({1, 5, 15, 30, 60, 120, 300, 900, 3600, 14400});
+}
+
+const char *StateMachine::name(int state) const
+{
+	return state >= 0 && (size_t)state < stateCount ? stateNames[state] : "UNKNOWN";
+}
+
+const Transition *StateMachine::find(int from, int to) const
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		if (table[i].from == from && table[i].to == to)
+			return &table[i];
+	}
+	return nullptr;
+}
+
+bool StateMachine::transition(int to, const char *payload)
+{
+	return transition(cell.state(), to, payload);
+}
+
+bool StateMachine::transition(int from, int to, const char *payload)
+{
+	const Transition *edge = find(from, to);
+	if (!edge)
+	{
+		metricAdd(rejectedCount);
+		return false;
+	}
+	if (!payload)
+		payload = "";
+	// The check and the publish happen under the lock, the hooks outside it.
+	// Of two tasks leaving the same state only the first gets past the
+	// check; the second is refused right away instead of waiting out the
+	// first one's onExit. Nobody sees the new state before onExit is done.
+	xSemaphoreTake(lock, portMAX_DELAY);
+	while (true)
+	{
+		if (cell.state() != from || leaving)
+		{
+			xSemaphoreGive(lock);
+			metricAdd(rejectedCount);
+			return false;
+		}
+		if (xSemaphoreTake(entering, 0) == pdTRUE)
+		{
+			xSemaphoreGive(entering);
+			break;
+		}
+		// The edge into `from` is still in its onEnter; go after it.
+		xSemaphoreGive(lock);
+		xSemaphoreTake(entering, portMAX_DELAY);
+		xSemaphoreGive(entering);
+		xSemaphoreTake(lock, portMAX_DELAY);
+	}
+	leaving = true;
+	xSemaphoreGive(lock);
+
+	if (edge->onExit)
+		edge->onExit(payload);
+
+	xSemaphoreTake(lock, portMAX_DELAY);
+	cell.publish(to, payload);
+	leaving = false;
+	// Nobody can be in an onEnter: every transition since ours started was
+	// refused.
+	xSemaphoreTake(entering, portMAX_DELAY);
+	xSemaphoreGive(lock);
+
+	uint32_t now = millis();
+	portENTER_CRITICAL(&mux);
+	uint32_t dwellMs = now - enteredMs;
+	enteredMs = now;
+	portEXIT_CRITICAL(&mux);
+	if ((size_t)from < stateCount)
+		dwellSeconds[from].observe(dwellMs / 1000);
+
+	if (edge->onEnter)
+		edge->onEnter(payload);
+	xSemaphoreGive(entering);
+	return true;
+}
+
+void StateMachine::writeMetrics(Print &out, const char *prefix)
+{
+	char name[64];
+	char labels[48];
+	snprintf(name, sizeof(name), "%s_dwell_seconds", prefix);
+	for (size_t i = 0; i < stateCount; i++)
+	{
+		snprintf(labels, sizeof(labels), "state=\"%s\"", stateNames[i]);
+		dwellSeconds[i].write(out, name, i == 0 ? "Time spent in each state before leaving it" : nullptr, labels);
+	}
+
+	portENTER_CRITICAL(&mux);
+	uint32_t entered = enteredMs;
+	portEXIT_CRITICAL(&mux);
+	snprintf(name, sizeof(name), "%s_current_seconds", prefix);
+	snprintf(labels, sizeof(labels), "state=\"%s\"", this->name(cell.state()));
+	metricWrite(out, name, "gauge", "Time spent so far in the current state", (millis() - entered) / 1000.0, labels);
+
+	snprintf(name, sizeof(name), "%s_rejected_transitions_total", prefix);
+	metricWrite(out, name, "counter", "State changes refused because the edge is not in the table, the state moved first or another task was already leaving it", rejected());
+}
@@ -0,0 +1,75 @@
+#include "supabase_client.h"
+#include "metrics.h"
+
+SupabaseClient::SupabaseClient(const char *baseUrl, const char *apiKey)
+	: baseUrl(baseUrl), apiKey(apiKey)
+{
+	// Same trust model HTTPClient used when it created its own client.
+	tls.setInsecure();
+	http.setReuse(true);
+}
+
+int SupabaseClient::get(const String &path, String &response)
+{
+	return request("GET", path, nullptr, response);
+}
+
+int SupabaseClient::patch(const String &path, const char *body, String &response)
+{
+	return request("PATCH", path, body, response);
+}
+
+int SupabaseClient::post(const String &path, const char *body, String &response)
+{
+	return request("POST", path, body, response);
+}
+
+int SupabaseClient::request(const char *method, const String &path, const char *body, String &response)
+{
+	String url = String(baseUrl) + path;
+	int code = HTTPC_ERROR_CONNECTION_REFUSED;
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		bool reused = tls.connected();
+		if (!reused)
+		{
+			handshakeCount++;
+			if (!http.begin(tls, url))
+				return HTTPC_ERROR_CONNECTION_REFUSED;
+		}
+		else if (!http.setURL(path))
+		{
+			return HTTPC_ERROR_CONNECTION_REFUSED;
+		}
+		http.addHeader("apikey", apiKey);
+		http.addHeader("Authorization", String("Bearer ") + apiKey);
+		http.addHeader("Content-Type", "application/json");
+		http.addHeader("Prefer", "return=representation");
+		uint32_t start = millis();
+		code = http.sendRequest(method, (uint8_t *)body, body ? strlen(body) : 0);
+		uint32_t elapsed = millis() - start;
+		metricAdd(metrics.backendRequests);
+		metricAdd(metrics.backendLatencyMsTotal, elapsed);
+		metricSet(metrics.backendLastLatencyMs, elapsed);
+		if (code <= 0 || code >= 500)
+			metricAdd(metrics.backendErrors);
+		if (code <= 0)
+		{
+			// Whatever broke, the socket is not reused.
+			http.end();
+			tls.stop();
+			// A kept-alive socket the server dropped while idle fails before
+			// the request leaves, so that one is retried on a fresh socket.
+			// Anything later (lost connection, payload half sent) may already
+			// have been applied and goes back to the caller.
+			if (reused && (code == HTTPC_ERROR_SEND_HEADER_FAILED || code == HTTPC_ERROR_NOT_CONNECTED))
+				continue;
+			return code;
+		}
+		response = http.getString();
+		// end() keeps the socket open because reuse is enabled.
+		http.end();
+		return code;
+	}
+	return code;
+}
@@ -0,0 +1,134 @@
+// SSE publisher against slow subscribers: 100 status changes 10 ms apart
+// to browsers draining one message every 0..200 ms, sent directly (the old
+// events.send()) and through the coalescing EventPublisher.
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include "event_publisher.h"
+
+void setUp() {}
+void tearDown() {}
+
+// A browser on a slow link: queues whatever it is sent, like
+// AsyncEventSourceClient, and gets one message onto the wire every drainMs.
+class SlowSubscriber : public EventSubscriber
+{
+public:
+	explicit SlowSubscriber(uint32_t drainMs) : drainMs(drainMs), lastDrainMs(millis()) {}
+
+	size_t backlog() override
+	{
+		drain();
+		return queue.size();
+	}
+
+	void send(const char *event, const char *data, uint32_t id) override
+	{
+		drain();
+		queue.push_back(data);
+		peak = max(peak, queue.size());
+	}
+
+	void drain()
+	{
+		uint32_t now = millis();
+		if (queue.empty())
+			lastDrainMs = now;
+		while (!queue.empty() && now - lastDrainMs >= drainMs)
+		{
+			received = queue.front();
+			queue.pop_front();
+			lastDrainMs += drainMs;
+		}
+	}
+
+	const uint32_t drainMs;
+	uint32_t lastDrainMs;
+	std::deque<std::string> queue;
+	std::string received;
+	size_t peak = 0;
+};
+
+struct SubscriberRun
+{
+	size_t peak;
+	size_t queued;
+	int current;
+};
+
+// maxBacklog == SIZE_MAX means no backpressure, i.e. direct sends.
+static SubscriberRun simulateSubscribers(int count, size_t maxBacklog)
+{
+	EventPublisher publisher(maxBacklog);
+	std::vector<SlowSubscriber *> subscribers;
+	for (int i = 0; i < count; i++)
+	{
+		subscribers.push_back(new SlowSubscriber(i * 200 / max(count - 1, 1)));
+		publisher.addSubscriber(subscribers.back());
+	}
+	std::atomic<bool> running(true);
+	std::thread pump([&]
+					 {
+		while (running)
+		{
+			publisher.pump();
+			delay(10);
+		} });
+
+	char data[64];
+	for (int i = 0; i < 100; i++)
+	{
+		snprintf(data, sizeof(data), "{\"state\":\"SCANNING\",\"payload\":\"update %d\"}", i);
+		publisher.publish("status", data);
+		delay(10);
+	}
+	// Long enough for the slowest subscriber to work off a bounded backlog.
+	uint32_t settleMs = maxBacklog == SIZE_MAX ? 0 : (maxBacklog + 2) * 200;
+	delay(settleMs);
+	running = false;
+	pump.join();
+
+	SubscriberRun run = {0, 0, 0};
+	for (SlowSubscriber *subscriber : subscribers)
+	{
+		subscriber->drain();
+		run.peak = max(run.peak, subscriber->peak);
+		run.queued += subscriber->queue.size();
+		run.current += subscriber->queue.empty() && subscriber->received == data;
+		publisher.removeSubscriber(subscriber);
+		delete subscriber;
+	}
+	if (maxBacklog == SIZE_MAX)
+		Serial.printf("sse: %d subscribers, direct send: peak queue %zu, %zu messages still queued\n", count, run.peak, run.queued);
+	else
+		Serial.printf("sse: %d subscribers, publisher (backlog %zu): peak queue %zu, %u delivered, %u dropped, %d/%d current after %u ms\n",
+					  count, maxBacklog, run.peak, publisher.delivered(), publisher.dropped(), run.current, count, settleMs);
+	return run;
+}
+
+static void test_direct_send_backs_up()
+{
+	SubscriberRun run = simulateSubscribers(50, SIZE_MAX);
+	TEST_ASSERT_GREATER_THAN(50, run.peak);
+}
+
+static void test_publisher_bounds_backlog_and_catches_up()
+{
+	const int count = 50;
+	SubscriberRun run = simulateSubscribers(count, 4);
+	TEST_ASSERT_LESS_OR_EQUAL(4, run.peak);
+	TEST_ASSERT_EQUAL(0, run.queued);
+	TEST_ASSERT_EQUAL(count, run.current);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_direct_send_backs_up);
+	RUN_TEST(test_publisher_bounds_backlog_and_catches_up);
+	return UNITY_END();
+}
@@ -0,0 +1,249 @@
+// Fingerprint polling of kiosk.cpp against the scripted sensor: how much
+// UART traffic an idle kiosk makes with the touch line and with the
+// polling backoff, and how fast each notices a finger. Also the match
+// latency over the two FINGERPRINT_TRANSPORT choices.
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <scripted_sensor.h>
+#include "kiosk.h"
+#include "rental_uplink.h"
+
+static ScriptedSensor sensor;
+
+// Touch line switchable at runtime; the camera decodes the code in view
+// once per frame.
+class TestPlatform : public KioskPlatform
+{
+public:
+	void stateEntered(SystemState state, const char *shown) override {}
+	void sendEnrollStatus(const char *status, const char *message) override {}
+	void powerUp() override {}
+	void powerDown() override {}
+	bool receiveQr(char *payload, size_t size, TickType_t timeout, int64_t *presentedUs) override
+	{
+		uint32_t start = millis();
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (inView && millis() - lastDecodeMs >= 30)
+				{
+					lastDecodeMs = millis();
+					snprintf(payload, size, "fp;1-Test");
+					*presentedUs = esp_timer_get_time();
+					return true;
+				}
+			}
+			if (timeout != portMAX_DELAY && millis() - start >= timeout)
+				return false;
+			delay(2);
+		}
+	}
+	bool sensorUntouched() override { return touchLine && !sensor.touched(); }
+
+	void showCode(bool show)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		inView = show;
+	}
+
+	std::atomic<bool> touchLine{false};
+
+private:
+	std::mutex mutex;
+	bool inView = false;
+	uint32_t lastDecodeMs = 0;
+};
+
+static TestPlatform platform;
+
+static bool accept(const RentalEvent &event)
+{
+	return true;
+}
+
+static bool waitFor(SystemState state, uint32_t timeoutMs = 5000)
+{
+	uint32_t start = millis();
+	while (kioskCurrentState() != state)
+	{
+		if (millis() - start > timeoutMs)
+			return false;
+		delay(1);
+	}
+	return true;
+}
+
+// Puts a finger on and returns the ms until the kiosk unlocked, then
+// finishes the rental.
+static uint32_t timeToUnlock(int print)
+{
+	uint32_t start = millis();
+	sensor.touch(print);
+	if (platform.touchLine)
+		xTaskNotifyGive(fingerprintTaskHandle); // the touch interrupt
+	TEST_ASSERT_TRUE(waitFor(UNLOCKED_SCANNING));
+	uint32_t elapsed = millis() - start;
+	sensor.lift();
+	platform.showCode(true);
+	TEST_ASSERT_TRUE(waitFor(SUCCESS));
+	platform.showCode(false);
+	TEST_ASSERT_TRUE(waitFor(LOCKED));
+	return elapsed;
+}
+
+// Sensor commands over an idle window of `ms`.
+static uint32_t idleCommands(uint32_t ms, uint32_t *searches)
+{
+	uint32_t commands = sensor.commands();
+	uint32_t counted = fingerprintUartTransactions;
+	uint32_t search = sensor.searches();
+	delay(ms);
+	commands = sensor.commands() - commands;
+	counted = fingerprintUartTransactions - counted;
+	// The counter is bumped just before each command goes out.
+	TEST_ASSERT_TRUE(counted >= commands && counted <= commands + 1);
+	*searches = sensor.searches() - search;
+	return commands;
+}
+
+void setUp() {}
+
+void tearDown()
+{
+	// Back to polling; wake the task if it sleeps on the touch line.
+	platform.touchLine = false;
+	xTaskNotifyGive(fingerprintTaskHandle);
+	TEST_ASSERT_EQUAL_UINT32(0, sensor.overlaps());
+}
+
+// Without a touch line the poll interval backs off to
+// FINGERPRINT_POLL_MAX_MS, and only getImage goes out while nobody touches.
+static void test_polling_backs_off_while_idle()
+{
+	uint32_t searches;
+	delay(FINGERPRINT_POLL_MAX_MS * 5); // let the backoff settle
+	uint32_t commands = idleCommands(3000, &searches);
+	Serial.printf("fingerprint: idle polling %u UART transactions/min (fixed %d ms polling: %d/min)\n",
+				  commands * 20, FINGERPRINT_POLL_MIN_MS, 60000 / FINGERPRINT_POLL_MIN_MS);
+	TEST_ASSERT_EQUAL_UINT32(0, searches);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(3000 / FINGERPRINT_POLL_MAX_MS + 1, commands);
+}
+
+static void test_touch_line_idle_is_silent()
+{
+	platform.touchLine = true;
+	xTaskNotifyGive(fingerprintTaskHandle); // pick up the new mode
+	delay(FINGERPRINT_POLL_MAX_MS + 50);
+	uint32_t searches;
+	uint32_t commands = idleCommands(3000, &searches);
+	Serial.printf("fingerprint: idle with touch line %u UART transactions/min\n", commands * 20);
+	TEST_ASSERT_EQUAL_UINT32(0, commands);
+}
+
+// Polling notices a finger within one backed-off interval, the touch line
+// right away.
+static void test_finger_is_noticed()
+{
+	const int rounds = 5;
+	uint32_t polled = 0, interrupted = 0;
+	for (int i = 0; i < rounds; i++)
+	{
+		delay(FINGERPRINT_POLL_MAX_MS * 3);
+		uint32_t ms = timeToUnlock(0x51);
+		polled = max(polled, ms);
+	}
+	platform.touchLine = true;
+	xTaskNotifyGive(fingerprintTaskHandle);
+	for (int i = 0; i < rounds; i++)
+	{
+		delay(FINGERPRINT_POLL_MAX_MS * 3);
+		uint32_t ms = timeToUnlock(0x51);
+		interrupted = max(interrupted, ms);
+	}
+	Serial.printf("fingerprint: touch to SCANNING worst %u ms polling, %u ms with touch line (match %u us)\n",
+				  polled, interrupted, fingerprintMatchLatencyUs);
+	TEST_ASSERT_TRUE(polled <= FINGERPRINT_POLL_MAX_MS + 100);
+	TEST_ASSERT_TRUE(interrupted < 100);
+}
+
+// getImage -> fingerSearch with a finger resting on the sensor, retried
+// the way onFingerprintTask does: a failed getImage backs the poll off, a
+// failed image2Tz or search polls again after FINGERPRINT_POLL_MIN_MS.
+static uint32_t matchLatencyUs(ScriptedSensor &transport)
+{
+	int64_t start = esp_timer_get_time();
+	uint32_t pollMs = FINGERPRINT_POLL_MIN_MS;
+	while (true)
+	{
+		if (transport.getImage() != FINGERPRINT_OK)
+			pollMs = min<uint32_t>(pollMs + FINGERPRINT_POLL_MIN_MS, FINGERPRINT_POLL_MAX_MS);
+		else if (transport.image2Tz() == FINGERPRINT_OK && transport.fingerSearch() == FINGERPRINT_OK)
+			return esp_timer_get_time() - start;
+		else
+			pollMs = FINGERPRINT_POLL_MIN_MS;
+		delay(pollMs);
+	}
+}
+
+static void reportLatency(const char *name, std::vector<uint32_t> &us, float *meanMs)
+{
+	std::sort(us.begin(), us.end());
+	uint64_t sum = 0;
+	for (uint32_t v : us)
+		sum += v;
+	*meanMs = sum / 1000.0f / us.size();
+	Serial.printf("fingerprint: %s match latency p50 %.1f ms, p99 %.1f ms, max %.1f ms, mean %.1f ms\n", name,
+				  us[us.size() / 2] / 1000.0f, us[us.size() * 99 / 100] / 1000.0f, us.back() / 1000.0f, *meanMs);
+}
+
+// Both transports run the same 57600 baud wire. The hardware UART has a
+// FIFO and no per-byte CPU work. EspSoftwareSerial is assumed to cost
+// 20 us per byte in its edge interrupts and to garble 1 byte in 1000 when
+// WiFi or flash operations mask interrupts mid-byte. Those two numbers are
+// assumptions, not measurements.
+static void test_match_latency_per_transport()
+{
+	const int matches = 200;
+	ScriptedSensor hardware(57600, 0, 0, 11);
+	ScriptedSensor software(57600, 20, 0.001f, 11);
+	hardware.enroll(1, 0x77);
+	software.enroll(1, 0x77);
+	hardware.touch(0x77);
+	software.touch(0x77);
+	std::vector<uint32_t> hw, sw;
+	for (int i = 0; i < matches; i++)
+	{
+		hw.push_back(matchLatencyUs(hardware));
+		sw.push_back(matchLatencyUs(software));
+	}
+	float hwMean, swMean;
+	reportLatency("hardware UART", hw, &hwMean);
+	reportLatency("software serial", sw, &swMean);
+	TEST_ASSERT_TRUE(hw[matches / 2] <= sw[matches / 2]);
+	TEST_ASSERT_TRUE(hwMean < swMean);
+	// Three round trips, 82 bytes at 57600 baud (14.2 ms), never retried.
+	TEST_ASSERT_TRUE(hw.back() < 50000);
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/fingerprint-nvs-XXXXXX";
+	setenv("NATIVE_NVS_DIR", mkdtemp(dir), 1);
+	sensor.enroll(3, 0x51);
+	if (!rentalUplinkBegin(accept) || !kioskBegin(sensor, platform, 20))
+	{
+		Serial.println("fingerprint: failed to start");
+		return 1;
+	}
+	UNITY_BEGIN();
+	RUN_TEST(test_polling_backs_off_while_idle);
+	RUN_TEST(test_touch_line_idle_is_silent);
+	RUN_TEST(test_finger_is_noticed);
+	RUN_TEST(test_match_latency_per_transport);
+	return UNITY_END();
+}
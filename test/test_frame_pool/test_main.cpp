@@ -0,0 +1,335 @@
+// FramePool reference counting, and the pool under a simulated camera and
+// /stream viewers: a camera thread publishes frames into framePool at the
+// firmware's 30 ms cadence while viewer threads borrow them like /stream
+// does. Set FRAMES_DIR to stream recorded JPEGs instead of synthetic blobs.
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_pool.h"
+
+void setUp() {}
+
+// Every test must leave all slots free again.
+void tearDown()
+{
+	framePool.clear();
+	FrameSlot *taken[FRAME_POOL_SLOTS];
+	for (int i = 0; i < FRAME_POOL_SLOTS; i++)
+	{
+		taken[i] = framePool.acquireWrite();
+		TEST_ASSERT_NOT_NULL(taken[i]);
+	}
+	TEST_ASSERT_NULL(framePool.acquireWrite());
+	for (int i = 0; i < FRAME_POOL_SLOTS; i++)
+		framePool.abort(taken[i]);
+}
+
+static FrameSlot *publishByte(uint8_t value)
+{
+	FrameSlot *slot = framePool.acquireWrite();
+	if (slot)
+	{
+		FramePool::writeCallback(slot, 0, &value, 1);
+		framePool.publish(slot);
+	}
+	return slot;
+}
+
+// Each reader pinning a different older frame takes a slot away from the
+// encoder, as documented at FRAME_POOL_SLOTS.
+static void test_readers_on_older_frames_pin_slots()
+{
+	TEST_ASSERT_EQUAL(3, FRAME_POOL_SLOTS);
+	publishByte(1);
+	FrameSlot *first = framePool.borrowLatest();
+	publishByte(2);
+	FrameSlot *second = framePool.borrowLatest();
+	TEST_ASSERT_TRUE(first != second);
+	// Third slot: written and published, the two older ones still pinned.
+	TEST_ASSERT_NOT_NULL(publishByte(3));
+	TEST_ASSERT_NULL(framePool.acquireWrite());
+
+	framePool.release(first);
+	FrameSlot *next = framePool.acquireWrite();
+	TEST_ASSERT_TRUE(next == first);
+	TEST_ASSERT_EQUAL(0, next->len);
+	framePool.abort(next);
+	framePool.release(second);
+}
+
+static size_t addressSpaceBytes()
+{
+	FILE *f = fopen("/proc/self/statm", "r");
+	unsigned long pages = 0;
+	if (f)
+	{
+		if (fscanf(f, "%lu", &pages) != 1)
+			pages = 0;
+		fclose(f);
+	}
+	return pages * 4096;
+}
+
+// The address space is capped so the first 64 MB slot fits and the second
+// does not; the first must be handed back.
+static void test_failed_begin_frees_earlier_slots()
+{
+	const size_t slotSize = 64 << 20;
+	static FramePool pool;
+	struct rlimit saved, capped;
+	getrlimit(RLIMIT_AS, &saved);
+	size_t before = addressSpaceBytes();
+	capped = saved;
+	capped.rlim_cur = before + slotSize * 3 / 2;
+	TEST_ASSERT_EQUAL(0, setrlimit(RLIMIT_AS, &capped));
+	bool started = pool.begin(slotSize);
+	size_t after = addressSpaceBytes();
+	setrlimit(RLIMIT_AS, &saved);
+	TEST_ASSERT_FALSE(started);
+	TEST_ASSERT_LESS_THAN(slotSize / 2, (int)(after - before));
+	TEST_ASSERT_NULL(pool.acquireWrite());
+}
+
+static void test_borrow_newer_skips_seen_frames()
+{
+	publishByte(1);
+	FrameSlot *slot = framePool.borrowNewer(0);
+	TEST_ASSERT_NOT_NULL(slot);
+	uint32_t seq = slot->seq;
+	framePool.release(slot);
+	TEST_ASSERT_NULL(framePool.borrowNewer(seq));
+	publishByte(2);
+	slot = framePool.borrowNewer(seq);
+	TEST_ASSERT_NOT_NULL(slot);
+	TEST_ASSERT_GREATER_THAN(seq, slot->seq);
+	TEST_ASSERT_EQUAL(2, slot->buf[0]);
+	// A consumer that is ahead has nothing newer.
+	TEST_ASSERT_NULL(framePool.borrowNewer(slot->seq + 5));
+	framePool.release(slot);
+
+	framePool.clear();
+	TEST_ASSERT_NULL(framePool.borrowLatest());
+}
+
+// Frame bodies are a pattern seeded by a frame number in the first four
+// bytes, so a reader can tell whether its slot was written while borrowed.
+static void fillFrame(FrameSlot *slot, uint32_t frame, size_t len)
+{
+	memcpy(slot->buf, &frame, sizeof(frame));
+	for (size_t i = sizeof(frame); i < len; i++)
+		slot->buf[i] = (uint8_t)(frame * 31 + i * 7);
+	slot->len = len;
+}
+
+// Returns the frame number, or 0 if the body does not match it.
+static uint32_t frameIntact(const FrameSlot *slot)
+{
+	uint32_t frame;
+	if (slot->len < sizeof(frame))
+		return 0;
+	memcpy(&frame, slot->buf, sizeof(frame));
+	for (size_t i = sizeof(frame); i < slot->len; i++)
+	{
+		if (slot->buf[i] != (uint8_t)(frame * 31 + i * 7))
+			return 0;
+	}
+	return frame;
+}
+
+// A fast encoder and eight readers holding frames for random times: no
+// borrowed frame may change under its reader, and sequence numbers only
+// grow.
+static void test_borrowed_frames_are_never_rewritten()
+{
+	std::atomic<bool> running(true);
+	std::atomic<uint32_t> published(0), dropped(0), checked(0), corrupted(0), reordered(0);
+	std::thread camera([&]
+					   {
+		for (uint32_t frame = 1; running; frame++)
+		{
+			FrameSlot *slot = framePool.acquireWrite();
+			if (slot)
+			{
+				fillFrame(slot, frame, 1000 + frame % 7000);
+				framePool.publish(slot);
+				published++;
+			}
+			else
+			{
+				dropped++;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		} });
+	std::vector<std::thread> readers;
+	for (int r = 0; r < 8; r++)
+	{
+		readers.emplace_back([&, r]
+							 {
+			uint32_t lastSeq = 0;
+			uint32_t seed = r + 1;
+			while (running)
+			{
+				FrameSlot *slot = framePool.borrowNewer(lastSeq);
+				if (!slot)
+				{
+					std::this_thread::sleep_for(std::chrono::microseconds(50));
+					continue;
+				}
+				if (slot->seq <= lastSeq)
+					reordered++;
+				lastSeq = slot->seq;
+				uint32_t frame = frameIntact(slot);
+				seed = seed * 1103515245 + 12345;
+				std::this_thread::sleep_for(std::chrono::microseconds((seed >> 16) % 1000));
+				if (!frame || frameIntact(slot) != frame)
+					corrupted++;
+				checked++;
+				framePool.release(slot);
+			} });
+	}
+	delay(1000);
+	running = false;
+	camera.join();
+	for (std::thread &t : readers)
+		t.join();
+
+	Serial.printf("pool: %u frames published, %u dropped, %u borrows checked\n", published.load(), dropped.load(), checked.load());
+	TEST_ASSERT_GREATER_THAN(100, published.load());
+	TEST_ASSERT_GREATER_THAN(100, checked.load());
+	TEST_ASSERT_EQUAL(0, corrupted.load());
+	TEST_ASSERT_EQUAL(0, reordered.load());
+}
+
+static std::vector<std::vector<uint8_t>> loadFrames(const char *dir)
+{
+	std::vector<std::vector<uint8_t>> frames;
+	DIR *d = dir ? opendir(dir) : nullptr;
+	if (d)
+	{
+		struct dirent *entry;
+		while ((entry = readdir(d)) != nullptr)
+		{
+			std::string path = std::string(dir) + "/" + entry->d_name;
+			FILE *f = fopen(path.c_str(), "rb");
+			if (!f)
+				continue;
+			std::vector<uint8_t> data;
+			uint8_t chunk[4096];
+			size_t n;
+			while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+				data.insert(data.end(), chunk, chunk + n);
+			fclose(f);
+			if (!data.empty() && data.size() <= FRAME_POOL_SLOT_SIZE)
+				frames.push_back(data);
+		}
+		closedir(d);
+	}
+	if (frames.empty())
+	{
+		// Roughly the size of a quality-40 QVGA grayscale JPEG.
+		for (int i = 0; i < 8; i++)
+			frames.push_back(std::vector<uint8_t>(6000 + i * 500, (uint8_t)i));
+	}
+	return frames;
+}
+
+// One producer and N consumers the way the streaming task and /stream in
+// main.cpp use the pool; the sockets are a memcpy and a delay.
+static void runViewers(int viewers)
+{
+	const int seconds = 1;
+	std::vector<std::vector<uint8_t>> frames = loadFrames(getenv("FRAMES_DIR"));
+	std::atomic<bool> running(true);
+	std::atomic<uint32_t> published(0), dropped(0);
+	std::vector<std::atomic<uint32_t>> received(viewers);
+
+	std::thread camera([&]
+					   {
+		size_t next = 0;
+		while (running)
+		{
+			const std::vector<uint8_t> &frame = frames[next++ % frames.size()];
+			FrameSlot *slot = framePool.acquireWrite();
+			if (!slot)
+			{
+				dropped++;
+			}
+			else if (FramePool::writeCallback(slot, 0, frame.data(), frame.size()) == frame.size())
+			{
+				gettimeofday(&slot->timestamp, NULL);
+				framePool.publish(slot);
+				published++;
+			}
+			else
+			{
+				framePool.abort(slot);
+			}
+			delay(30);
+		} });
+
+	std::vector<std::thread> clients;
+	for (int i = 0; i < viewers; i++)
+	{
+		clients.emplace_back([&, i]
+							 {
+			std::vector<uint8_t> socket(FRAME_POOL_SLOT_SIZE);
+			uint32_t lastSeq = 0;
+			while (running)
+			{
+				FrameSlot *slot = framePool.borrowNewer(lastSeq);
+				if (slot)
+				{
+					memcpy(socket.data(), slot->buf, slot->len);
+					lastSeq = slot->seq;
+					received[i]++;
+					framePool.release(slot);
+				}
+				// Slower viewers on odd indices, like a tablet on bad WiFi.
+				delay(i % 2 ? 70 : 5);
+			} });
+	}
+
+	delay(seconds * 1000);
+	running = false;
+	camera.join();
+	for (std::thread &t : clients)
+		t.join();
+
+	Serial.printf("stream, %d viewer(s): %u frames published, %u dropped (pool exhausted) in %d s\n",
+				  viewers, published.load(), dropped.load(), seconds);
+	for (int i = 0; i < viewers; i++)
+		Serial.printf("  viewer %2d: %.1f fps\n", i, received[i].load() / (float)seconds);
+
+	TEST_ASSERT_GREATER_THAN(0, published.load());
+	TEST_ASSERT_EQUAL_UINT32(0, dropped.load());
+	for (int i = 0; i < viewers; i++)
+		TEST_ASSERT_GREATER_OR_EQUAL(published.load() / (i % 2 ? 4 : 2), received[i].load());
+}
+
+static void test_viewers_share_frames()
+{
+	runViewers(1);
+	runViewers(4);
+	runViewers(16);
+}
+
+int main(int argc, char **argv)
+{
+	if (!framePool.begin())
+	{
+		Serial.println("Failed to allocate frame buffers :(");
+		return 1;
+	}
+	UNITY_BEGIN();
+	RUN_TEST(test_readers_on_older_frames_pin_slots);
+	RUN_TEST(test_borrow_newer_skips_seen_frames);
+	RUN_TEST(test_failed_begin_frees_earlier_slots);
+	RUN_TEST(test_borrowed_frames_are_never_rewritten);
+	RUN_TEST(test_viewers_share_frames);
+	return UNITY_END();
+}
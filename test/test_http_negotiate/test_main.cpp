@@ -0,0 +1,84 @@
+// Accept-Encoding and If-None-Match parsing for the pages served from flash.
+#include <Arduino.h>
+#include <unity.h>
+#include <string>
+#include "http_negotiate.h"
+
+void setUp() {}
+void tearDown() {}
+
+static void test_accepts_listed_codings()
+{
+	TEST_ASSERT_TRUE(acceptsEncoding("gzip, deflate, br", "br"));
+	TEST_ASSERT_TRUE(acceptsEncoding("gzip, deflate, br, zstd", "gzip"));
+	TEST_ASSERT_TRUE(acceptsEncoding("BR", "br"));
+	TEST_ASSERT_TRUE(acceptsEncoding("gzip;q=1.0, br;q=0.8", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("gzip, deflate", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("brotli", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding(nullptr, "br"));
+}
+
+static void test_zero_weight_refuses()
+{
+	TEST_ASSERT_FALSE(acceptsEncoding("br;q=0", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("gzip, br;q=0.000", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("gzip, br ; q = 0", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("br;Q=0.0, gzip", "br"));
+	TEST_ASSERT_TRUE(acceptsEncoding("br;q=0.001", "br"));
+	TEST_ASSERT_TRUE(acceptsEncoding("br;level=5;q=0.5", "br"));
+}
+
+static void test_wildcard_defers_to_listed_codings()
+{
+	TEST_ASSERT_TRUE(acceptsEncoding("gzip, *;q=0.1", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("gzip, *;q=0", "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding("*, br;q=0", "br"));
+	TEST_ASSERT_TRUE(acceptsEncoding("*;q=0, br", "br"));
+}
+
+static void test_etag_weak_comparison()
+{
+	const char *etag = "\"5b3ace0d512777d5\"";
+	TEST_ASSERT_TRUE(etagMatches("\"5b3ace0d512777d5\"", etag));
+	TEST_ASSERT_TRUE(etagMatches("W/\"5b3ace0d512777d5\"", etag));
+	TEST_ASSERT_TRUE(etagMatches("\"5b3ace0d512777d5\"", "W/\"5b3ace0d512777d5\""));
+	TEST_ASSERT_TRUE(etagMatches("\"old\", W/\"5b3ace0d512777d5\"", etag));
+	TEST_ASSERT_TRUE(etagMatches("\"a,b\",\"5b3ace0d512777d5\"", etag));
+	TEST_ASSERT_TRUE(etagMatches("*", etag));
+	TEST_ASSERT_FALSE(etagMatches("\"5b3ace0d512777d\"", etag));
+	TEST_ASSERT_FALSE(etagMatches("5b3ace0d512777d5", etag));
+	TEST_ASSERT_FALSE(etagMatches("\"5b3ace0d512777d5", etag));
+	TEST_ASSERT_FALSE(etagMatches("", etag));
+	TEST_ASSERT_FALSE(etagMatches(nullptr, etag));
+}
+
+// Browsers that cached several variants send long lists; the match may be
+// anywhere in them.
+static void test_long_headers()
+{
+	std::string inm, ae = "identity";
+	for (int i = 0; i < 20; i++)
+	{
+		inm += "W/\"00000000000000" + std::to_string(10 + i) + "\", ";
+		ae += ", x-coding-" + std::to_string(i) + ";q=0.5";
+	}
+	inm += "\"5b3ace0d512777d5\"";
+	ae += ", br";
+	TEST_ASSERT_GREATER_THAN(128, (int)inm.size());
+	TEST_ASSERT_GREATER_THAN(128, (int)ae.size());
+	TEST_ASSERT_TRUE(etagMatches(inm.c_str(), "\"5b3ace0d512777d5\""));
+	TEST_ASSERT_TRUE(acceptsEncoding(ae.c_str(), "br"));
+	TEST_ASSERT_FALSE(acceptsEncoding((ae + ";q=0").c_str(), "br"));
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_accepts_listed_codings);
+	RUN_TEST(test_zero_weight_refuses);
+	RUN_TEST(test_wildcard_defers_to_listed_codings);
+	RUN_TEST(test_etag_weak_comparison);
+	RUN_TEST(test_long_headers);
+	return UNITY_END();
+}
@@ -0,0 +1,69 @@
+// Word-at-a-time preview downscaler against its byte-at-a-time reference,
+// on a noisy frame; odd sizes exercise the tail handling.
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "image_scale.h"
+
+void setUp() {}
+void tearDown() {}
+
+static std::vector<uint8_t> noise(int width, int height)
+{
+	std::vector<uint8_t> frame(width * height);
+	uint32_t seed = 12345;
+	for (uint8_t &px : frame)
+	{
+		seed = seed * 1103515245 + 12345;
+		px = seed >> 24;
+	}
+	return frame;
+}
+
+static void benchmarkScaler(int width, int height)
+{
+	std::vector<uint8_t> frame = noise(width, height);
+	std::vector<uint8_t> fast(frame.size()), ref(frame.size());
+	const int iterations = 200;
+	for (int factor : {2, 4})
+	{
+		size_t len = downscaleGray(frame.data(), width, height, factor, fast.data());
+		size_t refLen = downscaleGrayScalar(frame.data(), width, height, factor, ref.data());
+		TEST_ASSERT_EQUAL(refLen, len);
+		TEST_ASSERT_EQUAL((size_t)(width / factor) * (height / factor), len);
+		TEST_ASSERT_EQUAL_MEMORY(ref.data(), fast.data(), len);
+
+		int64_t start = esp_timer_get_time();
+		for (int i = 0; i < iterations; i++)
+			downscaleGray(frame.data(), width, height, factor, fast.data());
+		int64_t swarUs = esp_timer_get_time() - start;
+		start = esp_timer_get_time();
+		for (int i = 0; i < iterations; i++)
+			downscaleGrayScalar(frame.data(), width, height, factor, ref.data());
+		int64_t scalarUs = esp_timer_get_time() - start;
+		Serial.printf("scale: %dx%d /%d -> %zu px, swar %.1f us/frame, scalar %.1f us/frame\n", width, height, factor, len,
+					  (double)swarUs / iterations, (double)scalarUs / iterations);
+	}
+}
+
+static void test_matches_reference_qvga() { benchmarkScaler(320, 240); }
+static void test_matches_reference_vga() { benchmarkScaler(640, 480); }
+static void test_matches_reference_odd_size() { benchmarkScaler(322, 243); }
+
+static void test_rejects_unsupported_factor()
+{
+	std::vector<uint8_t> frame = noise(16, 16);
+	std::vector<uint8_t> out(frame.size());
+	TEST_ASSERT_EQUAL(0, downscaleGray(frame.data(), 16, 16, 3, out.data()));
+	TEST_ASSERT_EQUAL(0, downscaleGrayScalar(frame.data(), 16, 16, 3, out.data()));
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_matches_reference_qvga);
+	RUN_TEST(test_matches_reference_vga);
+	RUN_TEST(test_matches_reference_odd_size);
+	RUN_TEST(test_rejects_unsupported_factor);
+	return UNITY_END();
+}
@@ -0,0 +1,96 @@
+// JsonWriter output, and the status event JSON built the way the SSE
+// handlers used to (std::string standing in for Arduino String, which
+// allocates the same way) against JsonWriter on the stack.
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include "json_writer.h"
+
+// Counts every heap allocation made through operator new.
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t n)
+{
+	allocations++;
+	void *p = malloc(n);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	free(p);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_escapes_strings()
+{
+	char buf[128];
+	const char *json = JsonWriter(buf, sizeof(buf)).field("state", "SCANNING").field("payload", "Dell \"blue\"\\#42\n").field("id", 7).finish();
+	TEST_ASSERT_EQUAL_STRING("{\"state\":\"SCANNING\",\"payload\":\"Dell \\\"blue\\\"\\\\#42\\n\",\"id\":7}", json);
+}
+
+static void test_truncates_to_closed_object()
+{
+	char buf[24];
+	JsonWriter writer(buf, sizeof(buf));
+	const char *json = writer.field("state", "SCANNING").field("payload", "a long payload that does not fit").finish();
+	TEST_ASSERT_FALSE(writer.ok());
+	TEST_ASSERT_LESS_THAN(sizeof(buf), strlen(json));
+	TEST_ASSERT_EQUAL('{', json[0]);
+	TEST_ASSERT_EQUAL('}', json[strlen(json) - 1]);
+}
+
+static void test_status_event_without_allocations()
+{
+	const char *payload = "Dell Latitude 5420 \"blue\" #42";
+	const int iterations = 200000;
+	volatile size_t sink = 0;
+
+	uint64_t allocs = allocations;
+	int64_t start = esp_timer_get_time();
+	for (int i = 0; i < iterations; i++)
+	{
+		std::string stateStr = "SCANNING";
+		std::string json = "{\"state\":\"" + stateStr + "\", \"payload\":\"" + payload + "\"}";
+		sink += json.size();
+	}
+	int64_t concatUs = esp_timer_get_time() - start;
+	double concatAllocs = (double)(allocations - allocs) / iterations;
+
+	allocs = allocations;
+	start = esp_timer_get_time();
+	char buf[384];
+	const char *json = "";
+	for (int i = 0; i < iterations; i++)
+	{
+		json = JsonWriter(buf, sizeof(buf)).field("state", "SCANNING").field("payload", payload).finish();
+		sink += strlen(json);
+	}
+	int64_t writerUs = esp_timer_get_time() - start;
+	uint64_t writerAllocs = allocations - allocs;
+
+	Serial.printf("json: concat %.0f ns/event %.1f allocs/event, JsonWriter %.0f ns/event %.1f allocs/event\n",
+				  concatUs * 1000.0 / iterations, concatAllocs, writerUs * 1000.0 / iterations, (double)writerAllocs / iterations);
+	TEST_ASSERT_EQUAL(0, writerAllocs);
+	TEST_ASSERT_EQUAL_STRING("{\"state\":\"SCANNING\",\"payload\":\"Dell Latitude 5420 \\\"blue\\\" #42\"}", json);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_escapes_strings);
+	RUN_TEST(test_truncates_to_closed_object);
+	RUN_TEST(test_status_event_without_allocations);
+	return UNITY_END();
+}
@@ -0,0 +1,359 @@
+// The rental flow of kiosk.cpp end to end on the host: a scripted
+// fingerprint sensor, a QR code held up to a simulated camera and the real
+// uplink, with deliveries recorded instead of sent.
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <scripted_sensor.h>
+#include "kiosk.h"
+#include "rental_uplink.h"
+
+// Live heap blocks allocated through operator new.
+static std::atomic<int64_t> liveBlocks(0);
+
+void *operator new(size_t n)
+{
+	void *p = malloc(n);
+	if (!p)
+		throw std::bad_alloc();
+	liveBlocks++;
+	return p;
+}
+
+void operator delete(void *p) noexcept
+{
+	if (p)
+		liveBlocks--;
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+static ScriptedSensor sensor;
+
+// A touch line on the sensor, like FINGERPRINT_TOUCH_PIN, and a camera that
+// decodes the code in view once per frame.
+class TestPlatform : public KioskPlatform
+{
+public:
+	void stateEntered(SystemState state, const char *shown) override
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (state == SUCCESS)
+			snprintf(successText, sizeof(successText), "%s", shown);
+	}
+	void sendEnrollStatus(const char *status, const char *message) override
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snprintf(lastEnrollStatus, sizeof(lastEnrollStatus), "%s", status);
+		enrollMessages++;
+	}
+	void powerUp() override
+	{
+		// Must happen while the old state is still published.
+		if (kioskCurrentState() != LOCKED)
+			badHandOffs++;
+		powered = true;
+	}
+	void powerDown() override
+	{
+		if (kioskCurrentState() != SUCCESS)
+			badHandOffs++;
+		powered = false;
+		powerDowns++;
+	}
+	bool receiveQr(char *payload, size_t size, TickType_t timeout, int64_t *presentedUs) override
+	{
+		uint32_t start = millis();
+		while (true)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (inView[0] && millis() - lastDecodeMs >= FRAME_MS)
+				{
+					lastDecodeMs = millis();
+					snprintf(payload, size, "%s", inView);
+					*presentedUs = shownUs;
+					return true;
+				}
+			}
+			if (timeout != portMAX_DELAY && millis() - start >= timeout)
+				return false;
+			delay(2);
+		}
+	}
+	bool sensorUntouched() override { return !sensor.touched(); }
+
+	void show(const char *code)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snprintf(inView, sizeof(inView), "%s", code);
+		shownUs = esp_timer_get_time();
+	}
+	void hide()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		inView[0] = 0;
+	}
+	String shownOnSuccess()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return String(successText);
+	}
+	String enrollStatus()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return String(lastEnrollStatus);
+	}
+
+	std::atomic<bool> powered{false};
+	std::atomic<uint32_t> badHandOffs{0};
+	std::atomic<uint32_t> powerDowns{0};
+	std::atomic<uint32_t> enrollMessages{0};
+
+private:
+	static const uint32_t FRAME_MS = 30;
+	std::mutex mutex;
+	char inView[64] = "";
+	int64_t shownUs = 0;
+	uint32_t lastDecodeMs = 0;
+	char successText[64] = "";
+	char lastEnrollStatus[16] = "";
+};
+
+static TestPlatform platform;
+
+static std::atomic<uint32_t> delivered(0);
+static std::atomic<int> lastLaptop(0), lastUser(0);
+
+static bool recordDelivery(const RentalEvent &event)
+{
+	lastLaptop = event.laptopId;
+	lastUser = event.userId;
+	delivered++;
+	return true;
+}
+
+static bool waitFor(SystemState state, uint32_t timeoutMs = 5000)
+{
+	uint32_t start = millis();
+	while (kioskCurrentState() != state)
+	{
+		if (millis() - start > timeoutMs)
+			return false;
+		delay(1);
+	}
+	return true;
+}
+
+static bool waitDelivered(uint32_t count, uint32_t timeoutMs = 5000)
+{
+	uint32_t start = millis();
+	while (delivered < count)
+	{
+		if (millis() - start > timeoutMs)
+			return false;
+		delay(1);
+	}
+	return true;
+}
+
+// Like the touch-out line firing its interrupt.
+static void touch(int print)
+{
+	sensor.touch(print);
+	xTaskNotifyGive(fingerprintTaskHandle);
+}
+
+// One rental: finger on, code held up, back to LOCKED.
+static void rent(int print, const char *code)
+{
+	touch(print);
+	TEST_ASSERT_TRUE(waitFor(UNLOCKED_SCANNING));
+	sensor.lift();
+	platform.show(code);
+	TEST_ASSERT_TRUE(waitFor(SUCCESS));
+	platform.hide();
+	TEST_ASSERT_TRUE(waitFor(LOCKED));
+}
+
+void setUp() {}
+
+void tearDown()
+{
+	TEST_ASSERT_EQUAL_UINT32(0, sensor.overlaps());
+	TEST_ASSERT_EQUAL_UINT32(0, platform.badHandOffs.load());
+}
+
+static void test_parses_qr_payload()
+{
+	uint32_t before = delivered;
+	TEST_ASSERT_FALSE(processQrPayload("kiosk 12-Dell", 3));
+	TEST_ASSERT_FALSE(processQrPayload("kiosk;12 Dell", 3));
+	TEST_ASSERT_FALSE(processQrPayload("kiosk;x-Dell", 3));
+	TEST_ASSERT_FALSE(processQrPayload("kiosk;12-Dell", -1));
+	TEST_ASSERT_TRUE(processQrPayload("kiosk;12-Dell;spare", 3));
+	TEST_ASSERT_TRUE(waitDelivered(before + 1));
+	TEST_ASSERT_EQUAL_INT(12, lastLaptop.load());
+	TEST_ASSERT_EQUAL_INT(3, lastUser.load());
+}
+
+static void test_rental_toggles_laptop_for_matched_user()
+{
+	uint32_t before = delivered;
+	rent(0xA1, "kiosk;42-ThinkPad");
+	TEST_ASSERT_EQUAL_STRING("42-ThinkPad", platform.shownOnSuccess().c_str());
+	TEST_ASSERT_FALSE(platform.powered);
+	TEST_ASSERT_TRUE(waitDelivered(before + 1));
+	TEST_ASSERT_EQUAL_INT(42, lastLaptop.load());
+	TEST_ASSERT_EQUAL_INT(7, lastUser.load());
+}
+
+static void test_unknown_finger_stays_locked()
+{
+	touch(0xEE);
+	delay(200);
+	sensor.lift();
+	TEST_ASSERT_EQUAL_INT(LOCKED, kioskCurrentState());
+	TEST_ASSERT_FALSE(platform.powered);
+}
+
+static void test_enrolled_finger_can_rent()
+{
+	TEST_ASSERT_TRUE(kioskStartEnroll(9));
+	TEST_ASSERT_EQUAL_INT(ENROLLING, kioskCurrentState());
+	TEST_ASSERT_FALSE(kioskStartEnroll(10));
+	sensor.touch(0xB2);
+	delay(300);
+	sensor.lift();
+	delay(1200);
+	sensor.touch(0xB2);
+	delay(300);
+	sensor.lift();
+	TEST_ASSERT_TRUE(waitFor(LOCKED, 5000));
+	TEST_ASSERT_EQUAL_STRING("success", platform.enrollStatus().c_str());
+	TEST_ASSERT_TRUE(sensor.enrolled(9));
+
+	uint32_t before = delivered;
+	rent(0xB2, "kiosk;5-MacBook");
+	TEST_ASSERT_TRUE(waitDelivered(before + 1));
+	TEST_ASSERT_EQUAL_INT(9, lastUser.load());
+}
+
+// Back-to-back rentals must not leave anything behind: no heap growth, a
+// power down per rental and every event delivered.
+static void test_hundreds_of_back_to_back_rentals()
+{
+	const int rentals = 300;
+	char code[32];
+	uint32_t before = delivered + 1;
+	rent(0xA1, "kiosk;1-Warmup");
+	TEST_ASSERT_TRUE(waitDelivered(before));
+	delay(20);
+	uint32_t powerDowns = platform.powerDowns;
+	int64_t blocks = liveBlocks;
+	uint32_t start = millis();
+	for (int i = 0; i < rentals; i++)
+	{
+		snprintf(code, sizeof(code), "kiosk;%d-Laptop", 100 + i % 50);
+		rent(0xA1, code);
+	}
+	uint32_t elapsed = millis() - start;
+	TEST_ASSERT_TRUE(waitDelivered(before + rentals));
+	delay(20);
+	Serial.printf("kiosk: %d rentals in %u ms (%.1f ms each), %u sensor commands, live heap blocks %+lld\n",
+				  rentals, elapsed, elapsed / (float)rentals, sensor.commands(), (long long)(liveBlocks - blocks));
+	TEST_ASSERT_EQUAL_UINT32(powerDowns + rentals, platform.powerDowns.load());
+	TEST_ASSERT_EQUAL_INT(0, (int)(liveBlocks - blocks));
+	TEST_ASSERT_EQUAL_UINT32(0, rentalUplinkPending());
+	TEST_ASSERT_FALSE(platform.powered);
+}
+
+static bool waitEnrollMessages(uint32_t count, uint32_t timeoutMs = 5000)
+{
+	uint32_t start = millis();
+	while (platform.enrollMessages < count)
+	{
+		if (millis() - start > timeoutMs)
+			return false;
+		delay(1);
+	}
+	return true;
+}
+
+// /start_enroll arriving while a finger is being matched: exactly one of
+// the two gets the sensor, and whichever it is finishes cleanly.
+static void test_enroll_racing_a_match()
+{
+	const int races = 10;
+	int enrollWins = 0, matchWins = 0;
+	for (int i = 0; i < races; i++)
+	{
+		int print = 0xC0 + i;
+		int id = 20 + i;
+		sensor.enroll(id, print);
+		uint32_t messages = platform.enrollMessages;
+		std::thread enroller([i, id]
+							 {
+			// Spread over the ~14 ms the match spends on the wire.
+			delay(i * 3);
+			kioskStartEnroll(id + 50); });
+		touch(print);
+		enroller.join();
+		while (kioskCurrentState() == LOCKED)
+			delay(1);
+		if (kioskCurrentState() == ENROLLING)
+		{
+			// go, wait (lift), go (touch again), success
+			enrollWins++;
+			TEST_ASSERT_TRUE(waitEnrollMessages(messages + 2));
+			sensor.lift();
+			TEST_ASSERT_TRUE(waitEnrollMessages(messages + 3));
+			sensor.touch(print);
+			TEST_ASSERT_TRUE(waitEnrollMessages(messages + 4));
+			sensor.lift();
+			TEST_ASSERT_TRUE(waitFor(LOCKED));
+			TEST_ASSERT_TRUE(sensor.enrolled(id + 50));
+		}
+		else
+		{
+			matchWins++;
+			TEST_ASSERT_TRUE(waitFor(UNLOCKED_SCANNING));
+			sensor.lift();
+			uint32_t before = delivered;
+			platform.show("kiosk;77-Race");
+			TEST_ASSERT_TRUE(waitFor(SUCCESS));
+			platform.hide();
+			TEST_ASSERT_TRUE(waitFor(LOCKED));
+			TEST_ASSERT_TRUE(waitDelivered(before + 1));
+			TEST_ASSERT_EQUAL_INT(id, lastUser.load());
+		}
+	}
+	Serial.printf("kiosk: %d races, enrollment won %d, match won %d\n", races, enrollWins, matchWins);
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/kiosk-nvs-XXXXXX";
+	setenv("NATIVE_NVS_DIR", mkdtemp(dir), 1);
+	sensor.enroll(7, 0xA1);
+	if (!rentalUplinkBegin(recordDelivery) || !kioskBegin(sensor, platform, 50))
+	{
+		Serial.println("kiosk: failed to start");
+		return 1;
+	}
+	UNITY_BEGIN();
+	RUN_TEST(test_parses_qr_payload);
+	RUN_TEST(test_rental_toggles_laptop_for_matched_user);
+	RUN_TEST(test_unknown_finger_stays_locked);
+	RUN_TEST(test_enrolled_finger_can_rent);
+	RUN_TEST(test_hundreds_of_back_to_back_rentals);
+	RUN_TEST(test_enroll_racing_a_match);
+	return UNITY_END();
+}
@@ -0,0 +1,343 @@
+// laptopToggle and SupabaseClient against the in-process HTTPS stand-in,
+// which plays PostgREST for one laptop_acc table.
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <unity.h>
+#include <atomic>
+#include <map>
+#include <thread>
+#include "laptop_toggle.h"
+
+// laptop_acc: id -> user_id (0 for null) and last_event.
+static std::map<int, int> laptops;
+static std::map<int, long> lastEvent;
+static int serverStatus = 200;
+// Rows the server actually changed.
+static uint32_t writes = 0;
+// Drop the answer to the next request that changes a row.
+static bool loseWriteResponse = false;
+
+static void wrote()
+{
+	writes++;
+	if (loseWriteResponse)
+		HttpServer.loseNextResponse();
+	loseWriteResponse = false;
+}
+
+static long jsonInt(const String &body, const char *key)
+{
+	int at = body.indexOf(key);
+	if (at < 0)
+		return 0;
+	at = body.indexOf(':', at);
+	return strtol(body.c_str() + at + 1, NULL, 10);
+}
+
+static String rows(int id)
+{
+	char buf[64];
+	if (laptops[id])
+		snprintf(buf, sizeof(buf), "[{\"id\":%d,\"user_id\":%d}]", id, laptops[id]);
+	else
+		snprintf(buf, sizeof(buf), "[{\"id\":%d,\"user_id\":null}]", id);
+	return String(buf);
+}
+
+// Does the row match every column=op.value filter in the query string?
+static bool matches(int id, const String &query)
+{
+	int at = 0;
+	while (at < (int)query.length())
+	{
+		int end = query.indexOf('&', at);
+		if (end < 0)
+			end = query.length();
+		String filter = query.substring(at, end);
+		at = end + 1;
+		int eq = filter.indexOf('=');
+		String column = filter.substring(0, eq);
+		String op = filter.substring(eq + 1);
+		long value = column == "id" ? id : column == "last_event" ? lastEvent[id] : laptops[id];
+		if (op.startsWith("eq.") && value != strtol(op.c_str() + 3, NULL, 10))
+			return false;
+		if (op.startsWith("neq.") && value == strtol(op.c_str() + 4, NULL, 10))
+			return false;
+		if (op == "is.null" && value != 0)
+			return false;
+		if (op == "not.is.null" && value == 0)
+			return false;
+	}
+	return true;
+}
+
+static int postgrest(const char *method, const String &uri, const String &body, String &response)
+{
+	if (serverStatus != 200)
+	{
+		response = "{\"message\":\"unavailable\"}";
+		return serverStatus;
+	}
+	if (strcmp(method, "POST") == 0 && uri == "/rest/v1/rpc/toggle_laptop_user")
+	{
+		int id = jsonInt(body, "p_laptop_id");
+		if (!laptops.count(id))
+		{
+			response = "[]";
+			return 200;
+		}
+		int user = jsonInt(body, "p_user_id");
+		long event = jsonInt(body, "p_event");
+		if ((laptops[id] && laptops[id] != user) || lastEvent[id] == event)
+		{
+			response = "[]";
+			return 200;
+		}
+		laptops[id] = laptops[id] ? 0 : user;
+		lastEvent[id] = event;
+		wrote();
+		response = rows(id);
+		return 200;
+	}
+	const char *table = "/rest/v1/laptop_acc?";
+	if (uri.startsWith(table))
+	{
+		String query = uri.substring(strlen(table));
+		int id = query.substring(query.indexOf("id=eq.") + 6).toInt();
+		if (!laptops.count(id) || !matches(id, query))
+		{
+			response = "[]";
+			return 200;
+		}
+		if (strcmp(method, "PATCH") == 0)
+		{
+			laptops[id] = body.indexOf("null") >= 0 ? 0 : jsonInt(body, "user_id");
+			if (body.indexOf("last_event") >= 0)
+				lastEvent[id] = jsonInt(body, "last_event");
+			wrote();
+		}
+		response = rows(id);
+		return 200;
+	}
+	response = "{\"message\":\"not found\"}";
+	return 404;
+}
+
+static SupabaseClient db("https://stand-in.supabase.co", "anon-key");
+static std::atomic<uint32_t> eventSeq(0);
+
+// A fresh scan, as the uplink would number it.
+static bool scan(SupabaseClient &client, int mode, int laptop_id, int user_id)
+{
+	return laptopToggle(client, mode, laptop_id, user_id, ++eventSeq, 0);
+}
+
+void setUp()
+{
+	laptops.clear();
+	lastEvent.clear();
+	laptops[5] = 0;
+	serverStatus = 200;
+	writes = 0;
+	loseWriteResponse = false;
+	WiFi.setConnected(true);
+	HttpServer.setHandler(postgrest);
+	HttpServer.setLatency(0, 0);
+}
+
+void tearDown() {}
+
+static void checkoutAndReturn(int mode)
+{
+	uint32_t handshakes = HttpServer.handshakes();
+	TEST_ASSERT_TRUE(scan(db, mode, 5, 3));
+	TEST_ASSERT_EQUAL_INT(3, laptops[5]);
+	TEST_ASSERT_TRUE(scan(db, mode, 5, 3));
+	TEST_ASSERT_EQUAL_INT(0, laptops[5]);
+	// Kept alive across both toggles.
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(handshakes + 1, HttpServer.handshakes());
+}
+
+static void test_patch_checkout_then_return()
+{
+	checkoutAndReturn(TOGGLE_MODE_PATCH);
+}
+
+static void test_rpc_checkout_then_return()
+{
+	uint32_t requests = HttpServer.requests();
+	checkoutAndReturn(TOGGLE_MODE_RPC);
+	TEST_ASSERT_EQUAL_UINT32(requests + 2, HttpServer.requests());
+}
+
+static void test_reconnects_after_idle_close()
+{
+	TEST_ASSERT_TRUE(scan(db, TOGGLE_MODE_PATCH, 5, 3));
+	uint32_t handshakes = HttpServer.handshakes();
+	HttpServer.closeIdle();
+	TEST_ASSERT_TRUE(scan(db, TOGGLE_MODE_PATCH, 5, 3));
+	TEST_ASSERT_EQUAL_INT(0, laptops[5]);
+	TEST_ASSERT_EQUAL_UINT32(handshakes + 1, HttpServer.handshakes());
+	TEST_ASSERT_EQUAL_UINT32(HttpServer.handshakes(), db.handshakes());
+}
+
+static void test_defers_without_wifi_or_on_5xx()
+{
+	uint32_t requests = HttpServer.requests();
+	WiFi.setConnected(false);
+	TEST_ASSERT_FALSE(scan(db, TOGGLE_MODE_PATCH, 5, 3));
+	TEST_ASSERT_EQUAL_UINT32(requests, HttpServer.requests());
+	WiFi.setConnected(true);
+	serverStatus = 503;
+	TEST_ASSERT_FALSE(scan(db, TOGGLE_MODE_PATCH, 5, 3));
+	TEST_ASSERT_EQUAL_INT(0, laptops[5]);
+	// An unknown laptop is a final answer, not something to retry.
+	serverStatus = 200;
+	TEST_ASSERT_TRUE(scan(db, TOGGLE_MODE_PATCH, 6, 3));
+}
+
+// Someone else's laptop is left alone in both modes.
+static void test_cannot_return_someone_elses_laptop()
+{
+	laptops[5] = 4;
+	TEST_ASSERT_TRUE(scan(db, TOGGLE_MODE_PATCH, 5, 3));
+	TEST_ASSERT_EQUAL_INT(4, laptops[5]);
+	TEST_ASSERT_TRUE(scan(db, TOGGLE_MODE_RPC, 5, 3));
+	TEST_ASSERT_EQUAL_INT(4, laptops[5]);
+	TEST_ASSERT_EQUAL_UINT32(0, writes);
+}
+
+// The server applied the toggle but the answer never arrived: the uplink
+// retries the same event, which must not flip the laptop back.
+static void redeliverAfterLostResponse(int mode)
+{
+	loseWriteResponse = true;
+	TEST_ASSERT_FALSE(laptopToggle(db, mode, 5, 3, 41, 0));
+	TEST_ASSERT_EQUAL_INT(3, laptops[5]);
+	TEST_ASSERT_TRUE(laptopToggle(db, mode, 5, 3, 41, 0));
+	TEST_ASSERT_EQUAL_INT(3, laptops[5]);
+
+	loseWriteResponse = true;
+	TEST_ASSERT_FALSE(laptopToggle(db, mode, 5, 3, 42, 0));
+	TEST_ASSERT_EQUAL_INT(0, laptops[5]);
+	TEST_ASSERT_TRUE(laptopToggle(db, mode, 5, 3, 42, 0));
+	TEST_ASSERT_EQUAL_INT(0, laptops[5]);
+	TEST_ASSERT_EQUAL_UINT32(2, writes);
+}
+
+static void test_patch_redelivery_is_idempotent()
+{
+	redeliverAfterLostResponse(TOGGLE_MODE_PATCH);
+}
+
+static void test_rpc_redelivery_is_idempotent()
+{
+	redeliverAfterLostResponse(TOGGLE_MODE_RPC);
+}
+
+// The read-then-write toggle this replaced: GET the row, then PATCH by id.
+static bool legacyToggle(SupabaseClient &client, int laptop_id, int user_id)
+{
+	String path = "/rest/v1/laptop_acc?id=eq." + String(laptop_id);
+	String response;
+	if (client.get(path, response) != 200)
+		return false;
+	char payload[64];
+	if (response.indexOf("\"user_id\":null") >= 0)
+		snprintf(payload, sizeof(payload), "{\"user_id\": %d}", user_id);
+	else
+		snprintf(payload, sizeof(payload), "{\"user_id\": null}");
+	return client.patch(path, payload, response) == 200;
+}
+
+#define TOGGLE_MODE_LEGACY -1
+
+static void toggle(SupabaseClient &client, int mode, int laptop_id, int user_id)
+{
+	if (mode == TOGGLE_MODE_LEGACY)
+		legacyToggle(client, laptop_id, user_id);
+	else
+		scan(client, mode, laptop_id, user_id);
+}
+
+static const uint32_t ROUND_TRIP_MS = 40;
+
+// Mean time of a checkout plus a return, from the second pair on so the
+// handshake is not counted.
+static uint32_t togglePairMs(int mode)
+{
+	HttpServer.setLatency(0, ROUND_TRIP_MS);
+	toggle(db, mode, 5, 3);
+	toggle(db, mode, 5, 3);
+	const int pairs = 5;
+	uint32_t start = millis();
+	for (int i = 0; i < pairs; i++)
+	{
+		toggle(db, mode, 5, 3);
+		toggle(db, mode, 5, 3);
+	}
+	TEST_ASSERT_EQUAL_INT(0, laptops[5]);
+	return (millis() - start) / pairs;
+}
+
+static void test_toggle_latency()
+{
+	uint32_t legacy = togglePairMs(TOGGLE_MODE_LEGACY);
+	uint32_t patch = togglePairMs(TOGGLE_MODE_PATCH);
+	uint32_t rpc = togglePairMs(TOGGLE_MODE_RPC);
+	Serial.printf("checkout+return at %u ms/round trip: GET+PATCH %u ms, conditional PATCH %u ms, RPC %u ms\n",
+				  ROUND_TRIP_MS, legacy, patch, rpc);
+	// 4 round trips -> 3 for PATCH (one for checkout, two for return) -> 2 for RPC.
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(legacy * 4 / 5, patch);
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(legacy * 3 / 5, rpc);
+}
+
+// Two kiosks scan the same free laptop for different users at once. Exactly
+// one of them may change the row, and it ends up rented to that user.
+static uint32_t raceLosses(int mode)
+{
+	static SupabaseClient kioskA("https://stand-in.supabase.co", "anon-key");
+	static SupabaseClient kioskB("https://stand-in.supabase.co", "anon-key");
+	HttpServer.setLatency(0, 5);
+	uint32_t losses = 0;
+	for (int i = 0; i < 40; i++)
+	{
+		laptops[5] = 0;
+		writes = 0;
+		std::thread a([&]() { toggle(kioskA, mode, 5, 3); });
+		std::thread b([&]() { delay(i % 8); toggle(kioskB, mode, 5, 4); });
+		a.join();
+		b.join();
+		if (writes != 1 || (laptops[5] != 3 && laptops[5] != 4))
+			losses++;
+	}
+	return losses;
+}
+
+static void test_racing_kiosks_claim_once()
+{
+	uint32_t legacy = raceLosses(TOGGLE_MODE_LEGACY);
+	uint32_t patch = raceLosses(TOGGLE_MODE_PATCH);
+	uint32_t rpc = raceLosses(TOGGLE_MODE_RPC);
+	Serial.printf("racing scans of one free laptop, 40 rounds: GET+PATCH lost %u, conditional PATCH %u, RPC %u\n",
+				  legacy, patch, rpc);
+	TEST_ASSERT_TRUE(legacy > 0);
+	TEST_ASSERT_EQUAL_UINT32(0, patch);
+	TEST_ASSERT_EQUAL_UINT32(0, rpc);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_patch_checkout_then_return);
+	RUN_TEST(test_rpc_checkout_then_return);
+	RUN_TEST(test_reconnects_after_idle_close);
+	RUN_TEST(test_defers_without_wifi_or_on_5xx);
+	RUN_TEST(test_cannot_return_someone_elses_laptop);
+	RUN_TEST(test_patch_redelivery_is_idempotent);
+	RUN_TEST(test_rpc_redelivery_is_idempotent);
+	RUN_TEST(test_toggle_latency);
+	RUN_TEST(test_racing_kiosks_claim_once);
+	return UNITY_END();
+}
@@ -0,0 +1,50 @@
+// Metric counters and the Prometheus text they are exported as.
+#include <Arduino.h>
+#include <StreamString.h>
+#include <unity.h>
+#include "metrics.h"
+
+void setUp() {}
+void tearDown() {}
+
+// An hour and a quarter of 60 ms encodes already passes 2^32 µs.
+static void test_totals_do_not_wrap()
+{
+	Counter64 encodeUs;
+	for (int i = 0; i < 80000; i++)
+		metricAdd(encodeUs, 60000);
+	TEST_ASSERT_TRUE(metricGet(encodeUs) == 4800000000ULL);
+
+	StreamString out;
+	metricWrite(out, "kiosk_jpeg_bytes_total", "counter", "Encoded JPEG bytes", metricGet(encodeUs) * 3);
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("kiosk_jpeg_bytes_total 14400000000\n"));
+}
+
+static void test_histogram_sum_does_not_wrap()
+{
+	Histogram hist{1000000, 100000000};
+	for (int i = 0; i < 50; i++)
+		hist.observe(100000000);
+	StreamString out;
+	hist.write(out, "decode_us", "Decode time");
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("decode_us_bucket{le=\"100000000\"} 50\n"));
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("decode_us_sum 5000000000\n"));
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("decode_us_count 50\n"));
+}
+
+static void test_fractions_are_kept()
+{
+	StreamString out;
+	metricWrite(out, "kiosk_preview_encode_seconds_total", "counter", nullptr, 4800000000ULL / 1e6);
+	metricWrite(out, "kiosk_frames_per_second", "gauge", nullptr, 0.1);
+	TEST_ASSERT_EQUAL_STRING("kiosk_preview_encode_seconds_total 4800\nkiosk_frames_per_second 0.1\n", out.c_str());
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_totals_do_not_wrap);
+	RUN_TEST(test_histogram_sum_does_not_wrap);
+	RUN_TEST(test_fractions_are_kept);
+	return UNITY_END();
+}
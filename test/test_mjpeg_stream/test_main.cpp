@@ -0,0 +1,290 @@
+// MjpegStream framing and MjpegHub wake-ups, and a benchmark of the
+// preview against a model of AsyncTCP: a viewer is only asked for more
+// data when its last write is acked or on the 500 ms poll, unless the
+// encoder wakes it. Compared with the old page polling /jpg every 200 ms.
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "mjpeg_stream.h"
+#include "stream_format.h"
+
+static MjpegHub hub;
+
+class CountingSink : public MjpegSink
+{
+public:
+	void resume() override { resumed++; }
+	int resumed = 0;
+};
+
+void setUp() {}
+
+// Every test must leave all slots free again.
+void tearDown()
+{
+	framePool.clear();
+	FrameSlot *taken[FRAME_POOL_SLOTS];
+	for (int i = 0; i < FRAME_POOL_SLOTS; i++)
+	{
+		taken[i] = framePool.acquireWrite();
+		TEST_ASSERT_NOT_NULL(taken[i]);
+	}
+	for (int i = 0; i < FRAME_POOL_SLOTS; i++)
+		framePool.abort(taken[i]);
+}
+
+static void publish(const char *jpeg)
+{
+	FrameSlot *slot = framePool.acquireWrite();
+	TEST_ASSERT_NOT_NULL(slot);
+	FramePool::writeCallback(slot, 0, jpeg, strlen(jpeg));
+	slot->timestamp.tv_sec = 12;
+	slot->timestamp.tv_usec = 345;
+	framePool.publish(slot);
+}
+
+// Reads one whole part in pieces of at most chunk bytes.
+static std::string readPart(MjpegStream &stream, size_t chunk)
+{
+	std::string out;
+	uint8_t buffer[64];
+	uint32_t parts = stream.partsSent();
+	while (stream.partsSent() == parts)
+	{
+		size_t n = stream.fill(buffer, chunk);
+		TEST_ASSERT_TRUE(n != MJPEG_TRY_AGAIN && n > 0);
+		out.append((const char *)buffer, n);
+	}
+	return out;
+}
+
+static void test_part_is_boundary_header_and_frame()
+{
+	CountingSink sink;
+	MjpegStream stream(framePool, sink);
+	publish("JPEGDATA");
+	std::string part = readPart(stream, 64);
+	std::string expected = std::string(_STREAM_BOUNDARY) +
+						   "Content-Type: image/jpeg\r\nContent-Length: 8\r\nX-Timestamp: 12.000345\r\n\r\nJPEGDATA";
+	TEST_ASSERT_EQUAL_STRING(expected.c_str(), part.c_str());
+	// Same frame again: nothing to send.
+	uint8_t buffer[64];
+	TEST_ASSERT_EQUAL_UINT32(MJPEG_TRY_AGAIN, stream.fill(buffer, sizeof(buffer)));
+}
+
+static void test_small_buffers_give_the_same_bytes()
+{
+	CountingSink sink;
+	MjpegStream whole(framePool, sink), pieces(framePool, sink);
+	publish("0123456789abcdefghij");
+	TEST_ASSERT_EQUAL_STRING(readPart(whole, 64).c_str(), readPart(pieces, 7).c_str());
+}
+
+static void test_wake_resumes_only_waiting_streams()
+{
+	CountingSink idle, busy;
+	MjpegStream waiting(framePool, idle), sending(framePool, busy);
+	hub.add(&waiting);
+	hub.add(&sending);
+	uint8_t buffer[8];
+	TEST_ASSERT_EQUAL_UINT32(MJPEG_TRY_AGAIN, waiting.fill(buffer, sizeof(buffer)));
+	publish("frame-one");
+	TEST_ASSERT_EQUAL_UINT32(sizeof(buffer), sending.fill(buffer, sizeof(buffer)));
+	TEST_ASSERT_EQUAL_INT(1, hub.wake());
+	TEST_ASSERT_EQUAL_INT(1, idle.resumed);
+	TEST_ASSERT_EQUAL_INT(0, busy.resumed);
+	// Resumed once per wait, not on every publish.
+	TEST_ASSERT_EQUAL_INT(0, hub.wake());
+	hub.remove(&waiting);
+	hub.remove(&sending);
+}
+
+static void test_end_finishes_the_current_part()
+{
+	CountingSink sink;
+	MjpegStream stream(framePool, sink);
+	publish("0123456789");
+	uint8_t buffer[16];
+	TEST_ASSERT_EQUAL_UINT32(sizeof(buffer), stream.fill(buffer, sizeof(buffer)));
+	stream.end();
+	size_t n;
+	while ((n = stream.fill(buffer, sizeof(buffer))) > 0)
+		TEST_ASSERT_TRUE(n != MJPEG_TRY_AGAIN);
+	TEST_ASSERT_EQUAL_UINT32(1, stream.partsSent());
+	// A newer frame does not restart it.
+	publish("next");
+	TEST_ASSERT_EQUAL_UINT32(0, stream.fill(buffer, sizeof(buffer)));
+}
+
+// --- Benchmark ---
+
+static const uint32_t ENCODER_FPS = 10;
+static const size_t FRAME_BYTES = 6000;
+// lwIP send buffer of the Arduino core, link of a phone on the kiosk AP.
+static const size_t SEND_WINDOW = 5744;
+static const uint32_t RTT_MS = 10;
+static const uint32_t LINK_BYTES_PER_MS = 500;
+static const uint32_t POLL_MS = 500;
+// Chunked encoding adds "<hex>\r\n" and "\r\n" to every write.
+static const size_t CHUNK_OVERHEAD = 8;
+// One /jpg fetch: the browser's GET and AsyncWebServer's response head.
+static const size_t JPG_REQUEST_BYTES = 420;
+static const size_t JPG_RESPONSE_HEAD_BYTES = 130;
+static const uint32_t JPG_POLL_MS = 200;
+static const int BENCH_SECONDS = 3;
+
+// One viewer's socket as AsyncTCP drives it. send() is
+// AsyncAbstractResponse::_ack: fill the free window and write it.
+class ModelSocket : public MjpegSink
+{
+public:
+	ModelSocket() : stream(framePool, *this) {}
+
+	void resume() override { send(); }
+
+	// Acks and polls, as the async_tcp task delivers them.
+	void run(std::atomic<bool> &stop)
+	{
+		uint32_t nextPoll = millis() + POLL_MS;
+		while (!stop)
+		{
+			hub.lock();
+			uint32_t now = millis();
+			if (inFlight && (int32_t)(now - ackDue) >= 0)
+			{
+				inFlight = 0;
+				send();
+			}
+			else if ((int32_t)(now - nextPoll) >= 0)
+			{
+				nextPoll += POLL_MS;
+				send();
+			}
+			hub.unlock();
+			delay(1);
+		}
+	}
+
+	MjpegStream stream;
+	size_t wireBytes = 0;
+
+private:
+	void send()
+	{
+		if (inFlight + CHUNK_OVERHEAD >= SEND_WINDOW)
+			return;
+		uint8_t buffer[SEND_WINDOW];
+		size_t n = stream.fill(buffer, SEND_WINDOW - inFlight - CHUNK_OVERHEAD);
+		if (n == MJPEG_TRY_AGAIN || n == 0)
+			return;
+		wireBytes += n + CHUNK_OVERHEAD;
+		inFlight += n;
+		ackDue = millis() + inFlight / LINK_BYTES_PER_MS + RTT_MS;
+	}
+
+	size_t inFlight = 0;
+	uint32_t ackDue = 0;
+};
+
+static void encoder(std::atomic<bool> &stop, bool wake)
+{
+	static uint8_t jpeg[FRAME_BYTES];
+	while (!stop)
+	{
+		FrameSlot *slot = framePool.acquireWrite();
+		if (slot)
+		{
+			FramePool::writeCallback(slot, 0, jpeg, sizeof(jpeg));
+			framePool.publish(slot);
+			if (wake)
+				hub.wake();
+		}
+		delay(1000 / ENCODER_FPS);
+	}
+}
+
+struct Result
+{
+	float fps;
+	size_t bytesPerFrame;
+};
+
+static Result streamBench(bool wake)
+{
+	ModelSocket viewer;
+	hub.add(&viewer.stream);
+	std::atomic<bool> stop(false);
+	std::thread camera(encoder, std::ref(stop), wake);
+	std::thread socket([&]()
+					   { viewer.run(stop); });
+	delay(BENCH_SECONDS * 1000);
+	stop = true;
+	camera.join();
+	socket.join();
+	hub.remove(&viewer.stream);
+	uint32_t parts = viewer.stream.partsSent();
+	return {parts / (float)BENCH_SECONDS, parts ? viewer.wireBytes / parts : 0};
+}
+
+// The old page: setInterval(200 ms) loading /jpg?<timestamp>, one fresh
+// connection and a full request/response per image.
+static Result jpgPollBench()
+{
+	std::atomic<bool> stop(false);
+	std::thread camera(encoder, std::ref(stop), false);
+	uint32_t seen = 0, fresh = 0;
+	size_t wireBytes = 0;
+	uint32_t start = millis();
+	while (millis() - start < BENCH_SECONDS * 1000u)
+	{
+		uint32_t fetchStart = millis();
+		// TCP connect, then GET and response.
+		delay(2 * RTT_MS);
+		FrameSlot *slot = framePool.borrowLatest();
+		if (slot)
+		{
+			delay(slot->len / LINK_BYTES_PER_MS);
+			wireBytes += JPG_REQUEST_BYTES + JPG_RESPONSE_HEAD_BYTES + slot->len;
+			if (slot->seq != seen)
+				fresh++;
+			seen = slot->seq;
+			framePool.release(slot);
+		}
+		uint32_t spent = millis() - fetchStart;
+		if (spent < JPG_POLL_MS)
+			delay(JPG_POLL_MS - spent);
+	}
+	stop = true;
+	camera.join();
+	return {fresh / (float)BENCH_SECONDS, fresh ? wireBytes / fresh : 0};
+}
+
+static void test_wake_keeps_up_with_the_encoder()
+{
+	Result polled = jpgPollBench();
+	Result acked = streamBench(false);
+	Result woken = streamBench(true);
+	Serial.printf("preview at %u fps, %u B frames, %u ms RTT:\n", ENCODER_FPS, (unsigned)FRAME_BYTES, RTT_MS);
+	Serial.printf("  /jpg every %u ms:          %4.1f new frames/s, %5u B/frame\n", JPG_POLL_MS, polled.fps, (unsigned)polled.bytesPerFrame);
+	Serial.printf("  /stream, ack/poll only:    %4.1f frames/s,     %5u B/frame\n", acked.fps, (unsigned)acked.bytesPerFrame);
+	Serial.printf("  /stream, woken on publish: %4.1f frames/s,     %5u B/frame\n", woken.fps, (unsigned)woken.bytesPerFrame);
+	TEST_ASSERT_TRUE(woken.fps >= ENCODER_FPS * 0.8f);
+	TEST_ASSERT_TRUE(woken.fps >= 2 * acked.fps);
+	TEST_ASSERT_TRUE(woken.fps > polled.fps);
+	TEST_ASSERT_LESS_THAN(polled.bytesPerFrame, woken.bytesPerFrame);
+}
+
+int main(int argc, char **argv)
+{
+	if (!framePool.begin(16 * 1024) || !hub.begin())
+		return 1;
+	UNITY_BEGIN();
+	RUN_TEST(test_part_is_boundary_header_and_frame);
+	RUN_TEST(test_small_buffers_give_the_same_bytes);
+	RUN_TEST(test_wake_resumes_only_waiting_streams);
+	RUN_TEST(test_end_finishes_the_current_part);
+	RUN_TEST(test_wake_keeps_up_with_the_encoder);
+	return UNITY_END();
+}
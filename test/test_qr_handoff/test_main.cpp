@@ -0,0 +1,219 @@
+// QR result hand-off from the scan task to the kiosk's QR task, through
+// the real qr_handoff queue and the real QR task from kioskBegin(). A
+// simulated camera stands in for qr_scanner.cpp: while powered it captures
+// a frame every 66 ms, spends 40 ms decoding it and publishes the code in
+// view with the capture time of the first frame that had it, as the scan
+// task does.
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <scripted_sensor.h>
+#include "kiosk.h"
+#include "metrics.h"
+#include "qr_handoff.h"
+#include "rental_uplink.h"
+
+static const uint32_t FRAME_MS = 66;
+static const uint32_t DECODE_MS = 40;
+
+static ScriptedSensor sensor;
+
+class HandoffPlatform : public KioskPlatform
+{
+public:
+	void stateEntered(SystemState state, const char *shown) override
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (state == SUCCESS)
+		{
+			snprintf(successText, sizeof(successText), "%s", shown);
+			successes++;
+		}
+	}
+	void sendEnrollStatus(const char *status, const char *message) override {}
+	void powerUp() override { powered = true; }
+	void powerDown() override { powered = false; }
+	// Same as DevicePlatform in main.cpp.
+	bool receiveQr(char *payload, size_t size, TickType_t timeout, int64_t *presentedUs) override
+	{
+		return qrScannerReceive(payload, size, timeout, presentedUs);
+	}
+	bool sensorUntouched() override { return !sensor.touched(); }
+
+	void show(const char *code)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		snprintf(inView, sizeof(inView), "%s", code);
+	}
+	void hide() { show(""); }
+	String shownOnSuccess()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return String(successText);
+	}
+
+	// The scan task: capture, decode, publish.
+	void runCamera()
+	{
+		bool located = false;
+		int64_t presentedUs = 0;
+		char code[64];
+		while (running)
+		{
+			if (!powered)
+			{
+				// Parked like qrScannerSleep(); the tracker is reset.
+				located = false;
+				delay(5);
+				continue;
+			}
+			int64_t capturedUs = esp_timer_get_time();
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				snprintf(code, sizeof(code), "%s", inView);
+			}
+			delay(DECODE_MS);
+			if (code[0])
+			{
+				if (!located)
+					presentedUs = capturedUs;
+				located = true;
+				qrScannerPublish(code, strlen(code), presentedUs);
+			}
+			else
+			{
+				located = false;
+			}
+			delay(FRAME_MS - DECODE_MS);
+		}
+	}
+
+	std::atomic<bool> powered{false};
+	std::atomic<int> successes{0};
+	std::atomic<bool> running{true};
+
+private:
+	std::mutex mutex;
+	char inView[64] = "";
+	char successText[64] = "";
+};
+
+static HandoffPlatform platform;
+
+static bool recordDelivery(const RentalEvent &event)
+{
+	return true;
+}
+
+static bool waitFor(SystemState state, uint32_t timeoutMs = 5000)
+{
+	uint32_t start = millis();
+	while (kioskCurrentState() != state)
+	{
+		if (millis() - start > timeoutMs)
+			return false;
+		delay(1);
+	}
+	return true;
+}
+
+static void touch(int print)
+{
+	sensor.touch(print);
+	xTaskNotifyGive(fingerprintTaskHandle);
+}
+
+// One rental; returns the time from holding the code up to SUCCESS in ms.
+static uint32_t rent(const char *code)
+{
+	touch(0xA1);
+	TEST_ASSERT_TRUE(waitFor(UNLOCKED_SCANNING));
+	sensor.lift();
+	// Held up at a random point of the capture cycle.
+	delay(rand() % FRAME_MS);
+	uint32_t shownMs = millis();
+	platform.show(code);
+	TEST_ASSERT_TRUE(waitFor(SUCCESS));
+	uint32_t latencyMs = millis() - shownMs;
+	platform.hide();
+	TEST_ASSERT_TRUE(waitFor(LOCKED));
+	return latencyMs;
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_present_to_success_is_recorded()
+{
+	const int rentals = 20;
+	Histogram &hist = metrics.qrPresentToSuccessMs;
+	uint32_t before[HISTOGRAM_MAX_BUCKETS + 1];
+	for (size_t i = 0; i <= hist.buckets; i++)
+		before[i] = metricGet(hist.counts[i]);
+
+	std::vector<uint32_t> shownToSuccess;
+	for (int i = 0; i < rentals; i++)
+		shownToSuccess.push_back(rent("kiosk;42-ThinkPad"));
+	TEST_ASSERT_EQUAL_STRING("42-ThinkPad", platform.shownOnSuccess().c_str());
+
+	std::sort(shownToSuccess.begin(), shownToSuccess.end());
+	Serial.printf("qr: shown->SUCCESS over %d rentals: p50 %u ms, p90 %u ms, max %u ms\n", rentals,
+				  shownToSuccess[rentals / 2], shownToSuccess[rentals * 9 / 10], shownToSuccess[rentals - 1]);
+	Serial.printf("qr: kiosk_qr_present_to_success_ms:");
+	uint32_t observed = 0, slow = 0;
+	for (size_t i = 0; i <= hist.buckets; i++)
+	{
+		uint32_t n = metricGet(hist.counts[i]) - before[i];
+		observed += n;
+		if (i == hist.buckets || hist.bounds[i] > 100)
+			slow += n;
+		if (i < hist.buckets)
+			Serial.printf(" le%u=%u", (unsigned)hist.bounds[i], n);
+		else
+			Serial.printf(" +Inf=%u\n", n);
+	}
+	TEST_ASSERT_EQUAL_UINT32(rentals, observed);
+	// The scanner's clock starts at the capture that had the code, so only
+	// the decode and the hand-off are left.
+	TEST_ASSERT_EQUAL_UINT32(0, slow);
+	// At most one capture + decode cycle, plus scheduling slack.
+	TEST_ASSERT_LESS_OR_EQUAL(2 * FRAME_MS + DECODE_MS, shownToSuccess[rentals * 9 / 10]);
+}
+
+// A result still queued from before the fingerprint match belongs to the
+// previous rental and must not end this one.
+static void test_results_from_before_scanning_are_dropped()
+{
+	TEST_ASSERT_TRUE(qrScannerPublish("kiosk;1-Stale", 13, esp_timer_get_time()));
+	int before = platform.successes;
+	rent("kiosk;2-Fresh");
+	// Only the fresh code; a stale SUCCESS would also pass rent() since the
+	// finger is still down and matches again.
+	TEST_ASSERT_EQUAL_INT(1, platform.successes - before);
+	TEST_ASSERT_EQUAL_STRING("2-Fresh", platform.shownOnSuccess().c_str());
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/qr-handoff-nvs-XXXXXX";
+	setenv("NATIVE_NVS_DIR", mkdtemp(dir), 1);
+	sensor.enroll(7, 0xA1);
+	if (!qrHandoffBegin() || !rentalUplinkBegin(recordDelivery) || !kioskBegin(sensor, platform, 20))
+	{
+		Serial.println("qr: failed to start");
+		return 1;
+	}
+	std::thread camera([]
+					   { platform.runCamera(); });
+	UNITY_BEGIN();
+	RUN_TEST(test_present_to_success_is_recorded);
+	RUN_TEST(test_results_from_before_scanning_are_dropped);
+	int failures = UNITY_END();
+	platform.running = false;
+	camera.join();
+	return failures;
+}
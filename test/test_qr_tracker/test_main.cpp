@@ -0,0 +1,247 @@
+// QrTracker against a scripted decoder that replays frame sequences: per
+// frame, where each code is and whether quirc would decode it there. A
+// code is located when a scanned region holds all of it. quirc's cost is
+// per pixel (binarize, flood fill), so the benchmark reports pixels
+// handed to the decoder as well as frames from presentation to decode.
+#include <Arduino.h>
+#include <unity.h>
+#include <algorithm>
+#include <vector>
+#include "qr_tracker.h"
+#include "metrics.h"
+
+static const int FRAME_W = 320;
+static const int FRAME_H = 240;
+
+struct TraceCode
+{
+	QrRegion box;
+	bool decodable;
+};
+
+typedef std::vector<std::vector<TraceCode>> Trace;
+
+class TraceDecoder : public QrDecoder
+{
+public:
+	QrFound decode(const uint8_t *frame, int width, int height, const QrRegion &region) override
+	{
+		QrFound found = {false, false, {0, 0, 0, 0}};
+		for (const TraceCode &code : *codes)
+		{
+			const QrRegion &b = code.box;
+			if (b.x < region.x || b.y < region.y || b.x + b.w > region.x + region.w || b.y + b.h > region.y + region.h)
+				continue;
+			found.located = true;
+			found.where = b;
+			if (code.decodable)
+			{
+				found.decoded = true;
+				break;
+			}
+		}
+		return found;
+	}
+
+	const std::vector<TraceCode> *codes = nullptr;
+};
+
+static TraceDecoder decoder;
+static uint8_t frame[FRAME_W * FRAME_H];
+
+static QrFound scanFrame(QrTracker &tracker, const std::vector<TraceCode> &codes)
+{
+	decoder.codes = &codes;
+	return tracker.scan(frame, FRAME_W, FRAME_H);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_roi_is_quantized_and_clamped()
+{
+	QrRegion roi = qrRoiAround({100, 80, 40, 40}, FRAME_W, FRAME_H);
+	TEST_ASSERT_EQUAL_INT(96, roi.w);
+	TEST_ASSERT_EQUAL_INT(96, roi.h);
+	TEST_ASSERT_EQUAL_INT(72, roi.x);
+	TEST_ASSERT_EQUAL_INT(52, roi.y);
+	roi = qrRoiAround({300, 220, 20, 20}, FRAME_W, FRAME_H);
+	TEST_ASSERT_EQUAL_INT(FRAME_W - roi.w, roi.x);
+	TEST_ASSERT_EQUAL_INT(FRAME_H - roi.h, roi.y);
+}
+
+static void test_tracks_a_located_code()
+{
+	QrTracker tracker(decoder);
+	std::vector<TraceCode> codes = {{{100, 80, 40, 40}, true}};
+	TEST_ASSERT_TRUE(scanFrame(tracker, codes).decoded);
+	TEST_ASSERT_EQUAL_UINT32(FRAME_W * FRAME_H, tracker.lastScannedPixels());
+	TEST_ASSERT_TRUE(tracker.tracking());
+	TEST_ASSERT_TRUE(scanFrame(tracker, codes).decoded);
+	TEST_ASSERT_EQUAL_UINT32(96 * 96, tracker.lastScannedPixels());
+}
+
+// The code moved out of the ROI: the same frame is scanned whole.
+static void test_empty_roi_falls_back_in_the_same_frame()
+{
+	QrTracker tracker(decoder);
+	std::vector<TraceCode> here = {{{20, 20, 40, 40}, true}};
+	std::vector<TraceCode> there = {{{240, 160, 40, 40}, true}};
+	scanFrame(tracker, here);
+	uint32_t fallbacks = metricGet(metrics.qrRoiFallbacks);
+	TEST_ASSERT_TRUE(scanFrame(tracker, there).decoded);
+	TEST_ASSERT_EQUAL_UINT32(fallbacks + 1, metricGet(metrics.qrRoiFallbacks));
+	TEST_ASSERT_EQUAL_UINT32(96 * 96 + FRAME_W * FRAME_H, tracker.lastScannedPixels());
+	TEST_ASSERT_EQUAL_INT(212, tracker.region().x);
+}
+
+// Something in view that quirc locates but never decodes must not hide a
+// readable code elsewhere for longer than QR_ROI_MAX_MISSES frames.
+static void test_undecodable_roi_forces_a_full_scan()
+{
+	QrTracker tracker(decoder);
+	std::vector<TraceCode> poster = {{{10, 10, 48, 48}, false}};
+	std::vector<TraceCode> both = {poster[0], {{200, 120, 60, 60}, true}};
+	scanFrame(tracker, poster);
+	TEST_ASSERT_TRUE(tracker.tracking());
+	uint32_t forced = metricGet(metrics.qrRoiForcedScans);
+	for (int i = 0; i < QR_ROI_MAX_MISSES; i++)
+		TEST_ASSERT_FALSE(scanFrame(tracker, poster).decoded);
+	TEST_ASSERT_EQUAL_UINT32(forced + 1, metricGet(metrics.qrRoiForcedScans));
+	TEST_ASSERT_EQUAL_UINT32(96 * 96 + FRAME_W * FRAME_H, tracker.lastScannedPixels());
+	// Stays on whole frames while only the poster is in view...
+	TEST_ASSERT_FALSE(tracker.tracking());
+	scanFrame(tracker, poster);
+	TEST_ASSERT_EQUAL_UINT32(FRAME_W * FRAME_H, tracker.lastScannedPixels());
+	// ...so a readable code decodes on the frame it appears in, and is tracked.
+	TEST_ASSERT_TRUE(scanFrame(tracker, both).decoded);
+	TEST_ASSERT_TRUE(tracker.tracking());
+	TEST_ASSERT_EQUAL_INT(200 + 30 - tracker.region().w / 2, tracker.region().x);
+}
+
+// --- Benchmark ---
+
+// Hand-held presentations: a code of 50-110 px drifts in, jitters a few px
+// per frame, is blurred (located, not decodable) on about one frame in
+// four, and is taken away again. A sticker that quirc locates but cannot
+// read sits in the corner of the optional second sequence.
+static Trace presentations(uint32_t seed, bool sticker)
+{
+	srand(seed);
+	Trace trace;
+	TraceCode stuck = {{4, 4, 44, 44}, false};
+	for (int p = 0; p < 30; p++)
+	{
+		for (int i = 0; i < 8; i++)
+			trace.push_back(sticker ? std::vector<TraceCode>{stuck} : std::vector<TraceCode>{});
+		int size = 50 + rand() % 61;
+		int x = 60 + rand() % (FRAME_W - size - 60), y = rand() % (FRAME_H - size);
+		int frames = 12 + rand() % 12;
+		for (int i = 0; i < frames; i++)
+		{
+			x = max(0, min(FRAME_W - size, x + rand() % 13 - 6));
+			y = max(0, min(FRAME_H - size, y + rand() % 13 - 6));
+			std::vector<TraceCode> codes = {{{x, y, size, size}, i >= 2 && rand() % 4 != 0}};
+			if (sticker)
+				codes.push_back(stuck);
+			trace.push_back(codes);
+		}
+	}
+	return trace;
+}
+
+struct Replay
+{
+	std::vector<uint32_t> pixels;
+	// Frames from the code entering to its first decode, per presentation.
+	std::vector<int> toDecode;
+	int missed;
+};
+
+// Replays a trace; fullOnly scans every frame whole, like the reader did.
+static Replay replay(const Trace &trace, bool fullOnly)
+{
+	QrTracker tracker(decoder);
+	Replay out = {{}, {}, 0};
+	int shownAt = -1;
+	bool decoded = false;
+	for (size_t f = 0; f < trace.size(); f++)
+	{
+		bool readable = false;
+		for (const TraceCode &code : trace[f])
+			readable |= code.box.x >= 60;
+		if (readable && shownAt < 0)
+		{
+			shownAt = f;
+			decoded = false;
+		}
+		if (!readable && shownAt >= 0)
+		{
+			if (!decoded)
+				out.missed++;
+			shownAt = -1;
+		}
+		if (fullOnly)
+			tracker.reset();
+		QrFound found = scanFrame(tracker, trace[f]);
+		out.pixels.push_back(tracker.lastScannedPixels());
+		if (found.decoded && found.where.x >= 60 && shownAt >= 0 && !decoded)
+		{
+			decoded = true;
+			out.toDecode.push_back(f - shownAt);
+		}
+	}
+	return out;
+}
+
+template <typename T>
+static T percentile(std::vector<T> v, int pct)
+{
+	if (v.empty())
+		return T();
+	std::sort(v.begin(), v.end());
+	return v[std::min(v.size() - 1, v.size() * pct / 100)];
+}
+
+static void report(const char *name, const Replay &r)
+{
+	uint64_t total = 0;
+	for (uint32_t p : r.pixels)
+		total += p;
+	Serial.printf("  %-22s px/frame mean %6u p50 %6u p90 %6u max %6u | frames to decode p50 %d p90 %d max %d, missed %d\n",
+				  name, (unsigned)(total / r.pixels.size()), percentile(r.pixels, 50), percentile(r.pixels, 90),
+				  percentile(r.pixels, 100), percentile(r.toDecode, 50), percentile(r.toDecode, 90),
+				  percentile(r.toDecode, 100), r.missed);
+}
+
+static void test_tracking_scans_fewer_pixels()
+{
+	Trace plain = presentations(7, false);
+	Trace sticker = presentations(7, true);
+	Replay fullPlain = replay(plain, true), roiPlain = replay(plain, false);
+	Replay fullSticker = replay(sticker, true), roiSticker = replay(sticker, false);
+	Serial.printf("QR tracking over %u frames of 30 presentations, %dx%d, QR_ROI_MAX_MISSES %d:\n",
+				  (unsigned)plain.size(), FRAME_W, FRAME_H, QR_ROI_MAX_MISSES);
+	report("full frame", fullPlain);
+	report("ROI tracking", roiPlain);
+	report("full frame, sticker", fullSticker);
+	report("ROI tracking, sticker", roiSticker);
+
+	TEST_ASSERT_LESS_THAN(percentile(fullPlain.pixels, 50), percentile(roiPlain.pixels, 50));
+	TEST_ASSERT_EQUAL_INT(fullPlain.missed, roiPlain.missed);
+	TEST_ASSERT_EQUAL_INT(percentile(fullPlain.toDecode, 90), percentile(roiPlain.toDecode, 90));
+	// The sticker costs at most the cap in latency and never a presentation.
+	TEST_ASSERT_EQUAL_INT(fullSticker.missed, roiSticker.missed);
+	TEST_ASSERT_LESS_OR_EQUAL(percentile(fullSticker.toDecode, 100) + QR_ROI_MAX_MISSES, percentile(roiSticker.toDecode, 100));
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_roi_is_quantized_and_clamped);
+	RUN_TEST(test_tracks_a_located_code);
+	RUN_TEST(test_empty_roi_falls_back_in_the_same_frame);
+	RUN_TEST(test_undecodable_roi_forces_a_full_scan);
+	RUN_TEST(test_tracking_scans_fewer_pixels);
+	return UNITY_END();
+}
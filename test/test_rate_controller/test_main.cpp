@@ -0,0 +1,83 @@
+// Preview rate controller against bandwidth-capped links, in virtual time:
+// a frame takes bytes / bandwidth to send, and a frame is only produced
+// every 1/30 s, so the sender waits for the next one.
+#include <Arduino.h>
+#include <unity.h>
+#include "rate_controller.h"
+
+void setUp() {}
+void tearDown() {}
+
+struct RateRun
+{
+	float fps;
+	float kbps;
+	uint32_t minQ;
+	uint32_t maxQ;
+};
+
+static RateRun simulateRateControl(uint32_t capKbps)
+{
+	RateController rate(40, 10, 60, 10, 1500);
+	const uint32_t frameIntervalUs = 33333;
+	uint64_t now = 0;
+	uint64_t lastSent = 0;
+	uint32_t sent = 0;
+	uint64_t sentBytes = 0;
+	uint32_t minQ = 100, maxQ = 0;
+	const uint64_t duration = 60ULL * 1000000;
+	while (now < duration)
+	{
+		// QVGA grayscale JPEG size grows roughly linearly with quality.
+		size_t bytes = 1500 + rate.quality() * 150;
+		uint64_t sendUs = (uint64_t)bytes * 8 * 1000 / capKbps;
+		uint64_t done = now + sendUs;
+		// Next frame after the send finished.
+		now = (done / frameIntervalUs + 1) * frameIntervalUs;
+		if (lastSent)
+			rate.onFrameSent(bytes, (uint32_t)(done - lastSent));
+		lastSent = done;
+		if (now > duration / 2)
+		{
+			// Only the second half counts, after the controller settled.
+			sent++;
+			sentBytes += bytes;
+			minQ = min<uint32_t>(minQ, rate.quality());
+			maxQ = max<uint32_t>(maxQ, rate.quality());
+		}
+	}
+	RateRun run = {sent / 30.0f, sentBytes * 8 / 30.0f / 1000, minQ, maxQ};
+	Serial.printf("rate: link %5u kbps -> %.1f fps, %.0f kbps, quality %u..%u\n", capKbps, run.fps, run.kbps, minQ, maxQ);
+	return run;
+}
+
+// Slow links trade quality for frame rate and stay near the 10 fps target.
+static void test_slow_links_hold_frame_rate()
+{
+	for (uint32_t cap : {250, 500, 1000})
+	{
+		RateRun run = simulateRateControl(cap);
+		TEST_ASSERT_GREATER_OR_EQUAL(8.5f, run.fps);
+		TEST_ASSERT_GREATER_OR_EQUAL(10, run.minQ);
+		TEST_ASSERT_LESS_OR_EQUAL(60, run.maxQ);
+	}
+}
+
+// Fast links are held under the 1500 kbps budget.
+static void test_fast_links_stay_in_budget()
+{
+	for (uint32_t cap : {2000, 8000})
+	{
+		RateRun run = simulateRateControl(cap);
+		TEST_ASSERT_GREATER_OR_EQUAL(10.0f, run.fps);
+		TEST_ASSERT_LESS_OR_EQUAL(1500.0f, run.kbps);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_slow_links_hold_frame_rate);
+	RUN_TEST(test_fast_links_stay_in_budget);
+	return UNITY_END();
+}
@@ -0,0 +1,72 @@
+// Rental trace report: per-stage rows and rentals that skip stages.
+#include <Arduino.h>
+#include <StreamString.h>
+#include <unity.h>
+#include "rental_trace.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Marks the stages in order, 2 ms apart, leaving out skip.
+static void traceRental(TraceStage skip)
+{
+	uint32_t id = traceBegin(esp_timer_get_time());
+	for (int stage = STAGE_MATCH; stage < STAGE_COUNT; stage++)
+	{
+		delay(2);
+		if (stage != skip)
+			traceMark(id, (TraceStage)stage);
+	}
+}
+
+static bool hasRow(const StreamString &report, const char *from, const char *to, unsigned count)
+{
+	char row[64];
+	snprintf(row, sizeof(row), "%-14s -> %-14s n=%-3u", from, to, count);
+	return report.indexOf(row) >= 0;
+}
+
+static void test_skipped_stage_is_labelled_with_actual_start()
+{
+	for (int i = 0; i < 3; i++)
+		traceRental(STAGE_COUNT);
+	for (int i = 0; i < 2; i++)
+		traceRental(STAGE_FIRST_FRAME);
+
+	StreamString report;
+	traceReport(report);
+	Serial.print(report.c_str());
+
+	TEST_ASSERT_TRUE(hasRow(report, "resumed", "first_frame", 3));
+	TEST_ASSERT_TRUE(hasRow(report, "first_frame", "qr_decoded", 3));
+	// The two rentals without a first frame are measured from resumed.
+	TEST_ASSERT_TRUE(hasRow(report, "resumed", "qr_decoded", 2));
+	TEST_ASSERT_TRUE(hasRow(report, "touch", "committed", 5));
+	TEST_ASSERT_EQUAL(-1, report.indexOf("first_frame    -> qr_decoded     n=5"));
+}
+
+static void test_marks_only_count_once()
+{
+	uint32_t id = traceBegin(esp_timer_get_time());
+	traceMark(id, STAGE_MATCH);
+	delay(20);
+	traceMark(id, STAGE_MATCH);
+	traceMark(0, STAGE_MATCH);
+
+	StreamString report;
+	traceReport(report);
+	int row = report.indexOf("touch          -> match          n=6");
+	TEST_ASSERT_GREATER_OR_EQUAL(0, row);
+	// The repeated mark 20 ms later did not move the stage.
+	String line = report.substring(row, report.indexOf('\n', row));
+	float maxMs = atof(line.c_str() + line.indexOf("max=") + 4);
+	TEST_ASSERT_LESS_THAN(15.0f, maxMs);
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_skipped_stage_is_labelled_with_actual_start);
+	RUN_TEST(test_marks_only_count_once);
+	return UNITY_END();
+}
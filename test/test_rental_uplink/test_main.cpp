@@ -0,0 +1,102 @@
+// Rental uplink against a backend that fails now and then and a WiFi link
+// that drops every few seconds. Events persist under a scratch
+// NATIVE_NVS_DIR, so the suite starts from an empty queue.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <unity.h>
+#include <atomic>
+#include <map>
+#include <set>
+#include "rental_uplink.h"
+
+void setUp() {}
+void tearDown() {}
+
+static float failRate = 0.3f;
+static volatile bool backendDown = false;
+static std::atomic<uint32_t> attempts(0), deliveries(0);
+// Laptop ids are unique per event here, so each maps to one event id.
+static std::map<int, uint32_t> eventIds;
+static uint32_t badEventIds = 0;
+
+static bool flakyBackend(const RentalEvent &event)
+{
+	attempts++;
+	if (event.eventId == 0 || (eventIds.count(event.laptopId) && eventIds[event.laptopId] != event.eventId))
+		badEventIds++;
+	eventIds[event.laptopId] = event.eventId;
+	if (backendDown)
+		return false;
+	delay(20 + rand() % 80);
+	if (rand() / (float)RAND_MAX < failRate)
+		return false;
+	deliveries++;
+	return true;
+}
+
+static void test_flaky_backend_gets_every_event()
+{
+	const int events = 4;
+	for (int i = 0; i < events; i++)
+	{
+		while (!rentalUplinkEnqueue(100 + i, 1 + i % 7))
+			delay(10);
+		delay(50);
+	}
+	uint32_t start = millis();
+	while (rentalUplinkPending() > 0 && millis() - start < 60000)
+	{
+		// Drop the link for a second every five.
+		WiFi.setConnected((millis() / 1000) % 5 != 0);
+		delay(100);
+	}
+	WiFi.setConnected(true);
+	Serial.printf("uplink: %u/%d events delivered in %u attempts, %u still pending\n",
+				  deliveries.load(), events, attempts.load(), (unsigned)rentalUplinkPending());
+	TEST_ASSERT_EQUAL_UINT32(events, deliveries.load());
+	TEST_ASSERT_EQUAL_UINT32(0, rentalUplinkPending());
+	// Retries reuse the event id; every event has its own.
+	TEST_ASSERT_EQUAL_UINT32(0, badEventIds);
+	std::set<uint32_t> distinct;
+	for (auto &entry : eventIds)
+		distinct.insert(entry.second);
+	TEST_ASSERT_EQUAL_UINT32(events, distinct.size());
+}
+
+// A full batch against a dead backend must still sleep between attempts.
+static void test_full_batch_waits_out_backoff()
+{
+	backendDown = true;
+	failRate = 0;
+	const int events = RENTAL_UPLINK_CAPACITY + 4;
+	for (int i = 0; i < events; i++)
+		TEST_ASSERT_TRUE(rentalUplinkEnqueue(200 + i, 1));
+	delay(200);
+	uint32_t before = attempts;
+	delay(2500);
+	uint32_t tried = attempts - before;
+	backendDown = false;
+	uint32_t start = millis();
+	while (rentalUplinkPending() > 0 && millis() - start < 30000)
+		delay(100);
+	Serial.printf("uplink: full batch, dead backend: %u attempts in 2.5 s; %u pending after recovery\n",
+				  tried, (unsigned)rentalUplinkPending());
+	// Backoff 1 s, 2 s, 4 s: at most two attempts fall in the window.
+	TEST_ASSERT_LESS_OR_EQUAL_UINT32(3, tried);
+	TEST_ASSERT_EQUAL_UINT32(0, rentalUplinkPending());
+}
+
+int main(int argc, char **argv)
+{
+	char dir[] = "/tmp/uplink-nvs-XXXXXX";
+	setenv("NATIVE_NVS_DIR", mkdtemp(dir), 1);
+	if (!rentalUplinkBegin(flakyBackend))
+	{
+		Serial.println("uplink: failed to start");
+		return 1;
+	}
+	UNITY_BEGIN();
+	RUN_TEST(test_flaky_backend_gets_every_event);
+	RUN_TEST(test_full_batch_waits_out_backoff);
+	return UNITY_END();
+}
@@ -0,0 +1,105 @@
+// Readers of the kiosk state against busy writers, with a mutex and with
+// the StateCell seqlock. Four reader threads (the async_tcp handlers)
+// check the state while two writers (QR / fingerprint tasks) publish every
+// 100 us; the mutex writer also stands in for a task preempted while
+// holding state_mutex by sleeping inside the lock now and then. Each
+// payload names its state so torn reads are detected. Host threads can be
+// descheduled inside the native critical section, unlike tasks on the
+// ESP32, so only throughput and consistency are checked, not read latency.
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "state_cell.h"
+
+void setUp() {}
+void tearDown() {}
+
+// Returns the number of torn reads.
+static uint64_t benchmarkStateReads(bool seqlock)
+{
+	StateCell cell(0);
+	std::mutex mutex;
+	int mutexState = 0;
+	std::string mutexPayload = "state 0";
+
+	std::atomic<bool> running(true);
+	std::atomic<uint64_t> reads(0), torn(0);
+	std::vector<std::thread> threads;
+	for (int w = 0; w < 2; w++)
+	{
+		threads.emplace_back([&, w]
+							 {
+			char payload[32];
+			for (int i = 0; running; i++)
+			{
+				int state = (i + w) % 4;
+				snprintf(payload, sizeof(payload), "state %d", state);
+				if (seqlock)
+				{
+					cell.publish(state, payload);
+				}
+				else
+				{
+					std::lock_guard<std::mutex> guard(mutex);
+					mutexState = state;
+					mutexPayload = payload;
+					if (i % 100 == 0)
+						std::this_thread::sleep_for(std::chrono::microseconds(500));
+				}
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			} });
+	}
+	for (int r = 0; r < 4; r++)
+	{
+		threads.emplace_back([&]
+							 {
+			StateSnapshot snapshot;
+			char expected[32];
+			while (running)
+			{
+				if (seqlock)
+				{
+					cell.read(snapshot);
+				}
+				else
+				{
+					std::lock_guard<std::mutex> guard(mutex);
+					snapshot.state = mutexState;
+					snprintf(snapshot.payload, sizeof(snapshot.payload), "%s", mutexPayload.c_str());
+				}
+				snprintf(expected, sizeof(expected), "state %d", snapshot.state);
+				if (strcmp(expected, snapshot.payload))
+					torn++;
+				reads++;
+			} });
+	}
+	delay(500);
+	running = false;
+	for (std::thread &t : threads)
+		t.join();
+	Serial.printf("state: %-7s %6.2f M reads/s across 4 readers, %llu torn\n", seqlock ? "seqlock" : "mutex",
+				  reads / 0.5 / 1e6, (unsigned long long)torn.load());
+	return torn;
+}
+
+static void test_mutex_reads_are_consistent()
+{
+	TEST_ASSERT_EQUAL(0, benchmarkStateReads(false));
+}
+
+static void test_seqlock_reads_are_consistent()
+{
+	TEST_ASSERT_EQUAL(0, benchmarkStateReads(true));
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_mutex_reads_are_consistent);
+	RUN_TEST(test_seqlock_reads_are_consistent);
+	return UNITY_END();
+}
@@ -0,0 +1,236 @@
+// StateMachine: table-driven edges, racing transitions and the metrics it
+// exports.
+#include <Arduino.h>
+#include <StreamString.h>
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "state_machine.h"
+
+enum
+{
+	IDLE,
+	BUSY,
+	DONE
+};
+
+static std::atomic<int> busyEntered(0), doneEntered(0);
+static char lastPayload[32];
+
+static void enterBusy(const char *payload)
+{
+	busyEntered++;
+	snprintf(lastPayload, sizeof(lastPayload), "%s", payload);
+}
+
+static void enterDone(const char *payload)
+{
+	doneEntered++;
+}
+
+constexpr Transition table[] = {
+	{IDLE, BUSY, nullptr, enterBusy},
+	{BUSY, DONE, nullptr, enterDone},
+	{DONE, IDLE, nullptr, nullptr},
+};
+static_assert(transitionsUnique(table, 3), "table has no duplicate edge");
+
+constexpr Transition duplicated[] = {
+	{IDLE, BUSY, nullptr, nullptr},
+	{BUSY, DONE, nullptr, nullptr},
+	{IDLE, BUSY, nullptr, enterBusy},
+};
+static_assert(!transitionsUnique(duplicated, 3), "duplicate edge is detected");
+
+static const char *const names[] = {"IDLE", "BUSY", "DONE"};
+
+void setUp()
+{
+	busyEntered = 0;
+	doneEntered = 0;
+	lastPayload[0] = 0;
+}
+
+void tearDown() {}
+
+static void test_follows_table_edges()
+{
+	StateCell cell(IDLE);
+	StateMachine machine(cell, table, 3, names, 3);
+	TEST_ASSERT_TRUE(machine.transition(BUSY, "go"));
+	TEST_ASSERT_EQUAL(BUSY, machine.state());
+	TEST_ASSERT_EQUAL(1, busyEntered.load());
+	TEST_ASSERT_EQUAL_STRING("go", lastPayload);
+
+	StateSnapshot snapshot;
+	cell.read(snapshot);
+	TEST_ASSERT_EQUAL_STRING("go", snapshot.payload);
+
+	TEST_ASSERT_TRUE(machine.transition(BUSY, DONE, ""));
+	TEST_ASSERT_TRUE(machine.transition(IDLE));
+	TEST_ASSERT_EQUAL(0, machine.rejected());
+}
+
+static void test_rejects_missing_edge_and_wrong_source()
+{
+	StateCell cell(IDLE);
+	StateMachine machine(cell, table, 3, names, 3);
+	TEST_ASSERT_FALSE(machine.transition(DONE));
+	TEST_ASSERT_FALSE(machine.transition(BUSY, DONE, ""));
+	TEST_ASSERT_EQUAL(IDLE, machine.state());
+	TEST_ASSERT_EQUAL(2, machine.rejected());
+	TEST_ASSERT_EQUAL(0, doneEntered.load());
+	TEST_ASSERT_EQUAL_STRING("UNKNOWN", machine.name(7));
+}
+
+// Eight threads race for every IDLE -> BUSY; exactly one may win each round.
+static void test_one_winner_per_race()
+{
+	StateCell cell(IDLE);
+	StateMachine machine(cell, table, 3, names, 3);
+	const int rounds = 500;
+	const int racers = 8;
+	std::atomic<int> round(0), ready(0), wins(0);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < racers; t++)
+	{
+		threads.emplace_back([&]
+							 {
+			for (int r = 0; r < rounds; r++)
+			{
+				while (round.load() != r)
+					std::this_thread::yield();
+				if (machine.transition(IDLE, BUSY, "race"))
+					wins++;
+				ready++;
+			} });
+	}
+	for (int r = 0; r < rounds; r++)
+	{
+		round = r;
+		while (ready.load() != racers * (r + 1))
+			std::this_thread::yield();
+		TEST_ASSERT_EQUAL(r + 1, wins.load());
+		TEST_ASSERT_TRUE(machine.transition(BUSY, DONE, ""));
+		TEST_ASSERT_TRUE(machine.transition(DONE, IDLE, ""));
+	}
+	for (std::thread &t : threads)
+		t.join();
+	TEST_ASSERT_EQUAL(rounds, busyEntered.load());
+	TEST_ASSERT_EQUAL((racers - 1) * rounds, machine.rejected());
+}
+
+// DONE -> IDLE has slow hooks, like powering down in the kiosk's
+// SUCCESS -> LOCKED. A task waiting to take IDLE -> BUSY must not get in
+// before both of them ran.
+static StateCell *orderedCell;
+static std::atomic<int> stateSeenByExit(-1);
+static std::atomic<bool> idleHooksDone(false), busyTooEarly(false);
+
+static void leaveDone(const char *payload)
+{
+	stateSeenByExit = orderedCell->state();
+	delay(30);
+}
+
+static void enterIdle(const char *payload)
+{
+	delay(10);
+	idleHooksDone = true;
+}
+
+static void enterBusyAfterIdle(const char *payload)
+{
+	if (!idleHooksDone)
+		busyTooEarly = true;
+}
+
+constexpr Transition ordered[] = {
+	{DONE, IDLE, leaveDone, enterIdle},
+	{IDLE, BUSY, nullptr, enterBusyAfterIdle},
+};
+
+static void test_hooks_finish_before_next_transition()
+{
+	StateCell cell(DONE);
+	orderedCell = &cell;
+	StateMachine machine(cell, ordered, 2, names, 3);
+	std::atomic<bool> racerWon(false);
+	std::thread racer([&]
+					  {
+		uint32_t start = millis();
+		while (millis() - start < 1000)
+		{
+			if (machine.transition(IDLE, BUSY, ""))
+			{
+				racerWon = true;
+				return;
+			}
+			std::this_thread::yield();
+		} });
+	delay(5);
+	TEST_ASSERT_TRUE(machine.transition(DONE, IDLE, ""));
+	racer.join();
+	TEST_ASSERT_EQUAL(DONE, stateSeenByExit.load());
+	TEST_ASSERT_TRUE(racerWon.load());
+	TEST_ASSERT_FALSE(busyTooEarly.load());
+}
+
+// IDLE -> BUSY powers something up in onExit, like the camera init in the
+// kiosk's LOCKED -> SCANNING. A task asking for IDLE -> DONE meanwhile, as
+// /start_enroll does from async_tcp, is told no at once, not after the hook.
+static void leaveIdleSlowly(const char *payload)
+{
+	delay(300);
+}
+
+constexpr Transition slowExit[] = {
+	{IDLE, BUSY, leaveIdleSlowly, nullptr},
+	{IDLE, DONE, nullptr, enterDone},
+};
+
+static void test_loser_is_refused_during_slow_exit()
+{
+	StateCell cell(IDLE);
+	StateMachine machine(cell, slowExit, 2, names, 3);
+	std::thread winner([&]
+					   { TEST_ASSERT_TRUE(machine.transition(IDLE, BUSY, "")); });
+	delay(50);
+	uint32_t start = millis();
+	TEST_ASSERT_FALSE(machine.transition(IDLE, DONE, ""));
+	uint32_t waitedMs = millis() - start;
+	TEST_ASSERT_EQUAL(IDLE, machine.state());
+	winner.join();
+	TEST_ASSERT_LESS_THAN(50, (int)waitedMs);
+	TEST_ASSERT_EQUAL(BUSY, machine.state());
+	TEST_ASSERT_EQUAL(0, doneEntered.load());
+	TEST_ASSERT_EQUAL(1, machine.rejected());
+}
+
+static void test_writes_dwell_and_rejection_metrics()
+{
+	StateCell cell(IDLE);
+	StateMachine machine(cell, table, 3, names, 3);
+	machine.transition(BUSY);
+	machine.transition(IDLE);
+	StreamString out;
+	machine.writeMetrics(out, "kiosk_state");
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("# TYPE kiosk_state_dwell_seconds histogram"));
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("kiosk_state_dwell_seconds_count{state=\"IDLE\"} 1\n"));
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("kiosk_state_dwell_seconds_count{state=\"BUSY\"} 0\n"));
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("kiosk_state_current_seconds{state=\"BUSY\"}"));
+	TEST_ASSERT_GREATER_OR_EQUAL(0, out.indexOf("kiosk_state_rejected_transitions_total 1\n"));
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_follows_table_edges);
+	RUN_TEST(test_rejects_missing_edge_and_wrong_source);
+	RUN_TEST(test_one_winner_per_race);
+	RUN_TEST(test_hooks_finish_before_next_transition);
+	RUN_TEST(test_loser_is_refused_during_slow_exit);
+	RUN_TEST(test_writes_dwell_and_rejection_metrics);
+	return UNITY_END();
+}
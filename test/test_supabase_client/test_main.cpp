@@ -0,0 +1,99 @@
+// SupabaseClient keep-alive and retry policy against the HTTPS stand-in,
+// counting handshakes and the requests that actually reached the server.
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WiFi.h>
+#include <unity.h>
+#include "supabase_client.h"
+
+static uint32_t applied = 0;
+
+// Every request that reaches the handler is applied, like a PATCH.
+static int applyAll(const char *method, const String &uri, const String &body, String &response)
+{
+	applied++;
+	response = "[{\"id\":1}]";
+	return 200;
+}
+
+static SupabaseClient db("https://stand-in.supabase.co", "anon-key");
+
+void setUp()
+{
+	HttpServer.setHandler(applyAll);
+	HttpServer.setLatency(0, 0);
+	WiFi.setConnected(true);
+	// Every test starts on an open connection.
+	String response;
+	db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response);
+	applied = 0;
+}
+
+void tearDown() {}
+
+static void test_keeps_one_connection()
+{
+	uint32_t handshakes = HttpServer.handshakes();
+	String response;
+	for (int i = 0; i < 10; i++)
+		TEST_ASSERT_EQUAL_INT(200, db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response));
+	TEST_ASSERT_EQUAL_UINT32(handshakes, HttpServer.handshakes());
+	TEST_ASSERT_EQUAL_UINT32(10, applied);
+}
+
+// The request never left, so it is sent again on a fresh socket.
+static void test_retries_silent_reset_once()
+{
+	uint32_t handshakes = HttpServer.handshakes();
+	String response;
+	HttpServer.resetNext();
+	TEST_ASSERT_EQUAL_INT(200, db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response));
+	TEST_ASSERT_EQUAL_UINT32(1, applied);
+	TEST_ASSERT_EQUAL_UINT32(handshakes + 1, HttpServer.handshakes());
+	TEST_ASSERT_EQUAL_UINT32(HttpServer.handshakes(), db.handshakes());
+}
+
+// The server applied it; resending would apply a toggle twice.
+static void test_does_not_retry_lost_response()
+{
+	uint32_t handshakes = HttpServer.handshakes();
+	String response;
+	HttpServer.loseNextResponse();
+	TEST_ASSERT_EQUAL_INT(HTTPC_ERROR_CONNECTION_LOST, db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response));
+	TEST_ASSERT_EQUAL_UINT32(1, applied);
+	TEST_ASSERT_EQUAL_UINT32(handshakes, HttpServer.handshakes());
+	// The broken socket is not reused.
+	TEST_ASSERT_EQUAL_INT(200, db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response));
+	TEST_ASSERT_EQUAL_UINT32(handshakes + 1, HttpServer.handshakes());
+}
+
+static void test_idle_close_costs_one_handshake()
+{
+	uint32_t handshakes = HttpServer.handshakes();
+	String response;
+	HttpServer.closeIdle();
+	TEST_ASSERT_EQUAL_INT(200, db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response));
+	TEST_ASSERT_EQUAL_UINT32(1, applied);
+	TEST_ASSERT_EQUAL_UINT32(handshakes + 1, HttpServer.handshakes());
+}
+
+// No link: refused once, nothing sent, no retry loop.
+static void test_no_wifi_fails_without_sending()
+{
+	uint32_t requests = HttpServer.requests();
+	String response;
+	WiFi.setConnected(false);
+	TEST_ASSERT_TRUE(db.patch("/rest/v1/laptop_acc?id=eq.1", "{}", response) < 0);
+	TEST_ASSERT_EQUAL_UINT32(requests, HttpServer.requests());
+}
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_keeps_one_connection);
+	RUN_TEST(test_retries_silent_reset_once);
+	RUN_TEST(test_does_not_retry_lost_response);
+	RUN_TEST(test_idle_close_costs_one_handshake);
+	RUN_TEST(test_no_wifi_fails_without_sending);
+	return UNITY_END();
+}